@@ -2,230 +2,379 @@
 #include <my92xx.h>
 #include <string.h>
 #include "src/myiot_timer_system.h"
+#include "src/myiot_ConfigStore.h"
 #include "src/myiot_DeviceConfig.h"
 #include "src/myiot_webServer.h"
 #include "src/myiot_ota.h"
+#include "src/myiot_httpUpdate.h"
 #include "src/myiot_Mqtt.h"
+#include "src/myiot_ddp.h"
+#include "src/myiot_webSocket.h"
+#include "src/myiot_metrics.h"
+#include "src/myiot_stallWatchdog.h"
+#include "src/myiot_clock.h"
+#include "src/myiot_alarmScheduler.h"
+#include "src/myiot_commandStage.h"
 #include "src/Sunrise.h"
 #include "src/SonoffB1.h"
+#include "src/Transition.h"
+#include "src/LightState.h"
+#include "src/LightCommands.h"
+#include "src/LightControl.h"
+
+/* The light output is selected at compile time, one firmware image per bulb type.
+ * Define "LIGHT_PWM" for a bulb with one PWM pin per channel (c, w, r, g, b).
+ * */
+#if defined(LIGHT_PWM)
+typedef LightOutput<PwmDriver<5, 4, 14, 12, 13>, ChannelMap<0, 1, 2, 3, 4>> Light;
+#else
+typedef SonoffB1 Light;
+#endif
 
 
 MyIOT::TimerSystem tsystem;
 MyIOT::Mqtt mqtt;
+MyIOT::ConfigStore store;
 MyIOT::DeviceConfig config;
 MyIOT::OTA ota;
+MyIOT::HttpUpdate httpUpdate;
 MyIOT::WebServer webServer;
+MyIOT::DdpReceiver ddp;
+MyIOT::WebSocketServer webSocket;
+MyIOT::StallWatchdog watchdog;
+MyIOT::Clock wallClock;
+MyIOT::AlarmScheduler alarms;
 
 Sunrise sunrise;
-SonoffB1 b1;
-
-
+Light light;
+Transition transition;
+LightState lightState;
+LightControl lightControl(light, lightState, transition, sunrise, store, mqtt, wallClock, alarms, watchdog);
 
+/// the metrics, that change by themselves, read once, so that every pass of "printMetrics" prints the same
+struct MetricsSnapshot
+{
+  MetricsSnapshot(): uptime(millis() / 1000), rssi(WiFi.RSSI()) {}
+  MyIOT::HeapSnapshot heap;
+  unsigned long uptime;
+  int rssi;
+};
+
+/// changes, whenever something visible of the light state changes
+uint32_t lightStateEtag()
+{
+  uint32_t tag = MyIOT::crc32(light.getFrame(), Light::NUMBER_OF_VALUES * sizeof(unsigned int));
+  uint8_t flags[] = {lightState.getPower(), transition.isRunning(), sunrise.isRunning(), ddp.isActive()};
+  tag = MyIOT::crc32(flags, sizeof(flags), tag);
+  const MyIOT::ConfigRecord& record = store.get();
+  return MyIOT::crc32(&record.lightMode, offsetof(MyIOT::ConfigRecord, reserved2) - offsetof(MyIOT::ConfigRecord, lightMode), tag);
+}
 
+enum {API_JSON_CAPACITY = JSON_OBJECT_SIZE(8) + JSON_OBJECT_SIZE(3) + JSON_ARRAY_SIZE(Light::NUMBER_OF_VALUES)};
 
-class ColorConfig
+/// GET /api/state
+void apiGetState()
 {
-public:
-  ColorConfig():ledColors{"200,200,0,0,0"}, enabled(false){}
-  const char* getLedColors() const{return ledColors;}
-  void setLedColors(const char* name) { strncpy(ledColors, name, sizeof(ledColors));    ledColors[sizeof(ledColors)-1] = 0; }
+  if (webServer.notModified(lightStateEtag())) return;
+
+  StaticJsonBuffer<API_JSON_CAPACITY> jsonBuffer;
+  JsonObject& json = jsonBuffer.createObject();
+  json["state"] = lightState.getPower() ? "ON" : "OFF";
+  json["brightness"] = lightState.getBrightness();
+  json["color_mode"] = lightState.getColorModeName();
+  json["color_temp"] = lightState.getColorTemp();
+  JsonArray& frame = json.createNestedArray("frame");
+  for (size_t i = 0; i < Light::NUMBER_OF_VALUES; i++)
+  {
+    frame.add(light.getFrame()[i]);
+  }
+  json["transition"] = transition.isRunning();
+  json["sunrise"] = sunrise.isRunning();
+  json["stream"] = ddp.isActive();
+  webServer.sendJson(200, json);
+}
 
-  bool getEnabled() const {return enabled;}
-  void setEnabled(bool enable){enabled = enable;}
+/// PUT /api/state {"state": "ON", "frame": [c,w,r,g,b] or "c,w,r,g,b", "scene": "warm", "transition": ms, "sunrise": seconds}
+/* Otherwise the fields of "LightState::apply" change the light state, e.g. {"brightness_step": 20}.
+ * */
+void apiSetState()
+{
+  ESP8266WebServer& server = webServer.getServer();
+  char buffer[256] = {0};
+  server.arg("plain").toCharArray(buffer, sizeof(buffer));
 
-  void setup()
+  StaticJsonBuffer<API_JSON_CAPACITY> jsonBuffer;
+  JsonObject& json = jsonBuffer.parseObject(buffer);
+  if (!json.success())
   {
-     fsReadConfig();
+    server.send_P(400, PSTR("text/plain"), PSTR("invalid JSON"));
+    return;
   }
 
-  void save(){fsSaveConfig();}
-private:
-  static constexpr const char * CONFIG_FILE = "/color_config.json";
-  char ledColors[40];
-  bool enabled;
-
-  void fsReadConfig()
-   {
-     if (SPIFFS.begin())
-     {
-       if (SPIFFS.exists(CONFIG_FILE))
-       {
-         File configFile = SPIFFS.open(CONFIG_FILE, "r");
-         if (configFile)
-         {
-           size_t size = configFile.size();
-           std::unique_ptr<char[]> buffer(new char[size]); // dynamic memory !!!
-           configFile.readBytes(buffer.get(), size);
-           configFile.close();
-
-           DynamicJsonBuffer jsonBuffer;
-           JsonObject& json = jsonBuffer.parseObject(buffer.get());
-           if (json.success())
-           {
-             auto jsonLedColors = json["ledColors"];
-             if (jsonLedColors.success())
-             {
-               strncpy(ledColors, jsonLedColors, sizeof(ledColors));
-             }
-
-             auto jsonEnabled = json["enabled"];
-             if (jsonEnabled.success())
-             {
-        	 enabled = 0 == ::strcmp("1", jsonEnabled);
-             }
-
-           } else error("failed to parse config file data");
-         }
-         else error("failed to open config file");
-       }
-       else info("no config file");
-     }
-     else error("SPIFFS.begin() failed");
-   }
-  void fsSaveConfig()
+  uint32_t transitionMs = json["transition"].as<unsigned long>();
+  if (json.containsKey("sunrise"))
   {
-    info("fsSaveConfig()");
-    DynamicJsonBuffer jsonBuffer;
-    JsonObject& json = jsonBuffer.createObject();
-
-    info("device_name", ledColors);
-
-    json["ledColors"] = ledColors;
-    json["enabled"] = enabled ? "1" : "0";
-    File configFile = SPIFFS.open(CONFIG_FILE, "w");
-    if (configFile)
-    {
-      json.printTo(configFile);
-      configFile.close();
-    }
-    else error ("failed to save config file");
+    lightControl.startSunrise(json["sunrise"].as<unsigned long>());
   }
-  void error(const char* msg)
+  else if (json.containsKey("scene"))
   {
-    Serial.print("ColorConfig error: ");
-    Serial.println(msg);
+    char frame[LightCommands::FRAME_LENGTH];
+    if (!LightCommands::findScene(json["scene"], frame, sizeof(frame)))
+    {
+      server.send_P(404, PSTR("text/plain"), PSTR("unknown scene"));
+      return;
+    }
+    lightControl.control(frame, transitionMs);
   }
-  void info(const char* msg)
+  else if (json.containsKey("frame"))
   {
-    Serial.print("ColorConfig info: ");
-    Serial.println(msg);
+    char frame[40];
+    JsonVariant value = json["frame"];
+    if (value.is<JsonArray&>())
+    {
+      JsonArray& values = value.as<JsonArray&>();
+      snprintf_P(frame, sizeof(frame), PSTR("%u,%u,%u,%u,%u"), values[0].as<unsigned int>(), values[1].as<unsigned int>(),
+          values[2].as<unsigned int>(), values[3].as<unsigned int>(), values[4].as<unsigned int>());
+    }
+    else
+    {
+      MyIOT::ConfigStore::setString(frame, value.as<const char*>(), sizeof(frame));
+    }
+    lightControl.control(frame, transitionMs);
   }
-  void info(const char* msg1, const char* msg2)
+  else
   {
-    Serial.print("DeviceConfig info: ");
-    Serial.print(msg1);
-    Serial.print(" ");
-    Serial.println(msg2);
+    uint32_t seconds = 0; // "transition" is in ms here
+    lightControl.applyLightState(lightState.apply(json, seconds), transitionMs);
   }
-} colorConfig;
+  apiGetState();
+}
 
+/// the light state as compact JSON message for the WebSocket clients
+void printLightState(char* buffer, size_t size)
+{
+  const unsigned int* frame = light.getFrame();
+  snprintf_P(buffer, size, PSTR("{\"state\":\"%s\",\"frame\":[%u,%u,%u,%u,%u],\"transition\":%d,\"sunrise\":%d,\"stream\":%d}"),
+      lightState.getPower() ? "ON" : "OFF", frame[0], frame[1], frame[2], frame[3], frame[4],
+      transition.isRunning(), sunrise.isRunning(), ddp.isActive());
+}
 
-void setup() {
-  Serial.begin(115200);
+/// send the light state to the WebSocket clients, whenever it changed
+void webSocketStateUpdate()
+{
+  static uint32_t lastEtag = 0;
+  uint32_t etag = lightStateEtag();
+  if (etag == lastEtag || 0 == webSocket.getClients()) return;
+  lastEtag = etag;
+
+  char buffer[128];
+  printLightState(buffer, sizeof(buffer));
+  webSocket.broadcast(buffer);
+}
 
-  config.setup();
-  colorConfig.setup();
+void webSocketTelemetry()
+{
+  if (0 == webSocket.getClients()) return;
+  char buffer[96];
+  snprintf_P(buffer, sizeof(buffer), PSTR("{\"rssi\":%d,\"heap\":%u,\"uptime\":%lu,\"dropped\":%lu,\"fps\":%lu}"),
+      WiFi.RSSI(), ESP.getFreeHeap(), millis() / 1000, webSocket.getDropped(), light.getFramesPerSecond());
+  webSocket.broadcast(buffer);
+}
 
-  ota.setup(config.getDeviceName());
-  mqtt.setup(config.getDeviceName(), config.getMqttServer());
-  webServer.setup(config);
+/// all metrics in the Prometheus text format
+void printMetrics(Print& out, const MetricsSnapshot& snapshot)
+{
+  MyIOT::MetricsWriter metrics(out);
+  metrics.heap(snapshot.heap);
+  metrics.gauge(F("uptime_seconds"), snapshot.uptime);
+  metrics.timerSystem(tsystem);
+  lightControl.printMetrics(metrics);
+  metrics.gauge(F("stalls"), watchdog.count());
+  metrics.counter(F("stream_packets_total"), ddp.getReceived());
+  metrics.counter(F("stream_invalid_total"), ddp.getInvalid());
+  metrics.counter(F("stream_lost_total"), ddp.getLost());
+  metrics.gauge(F("websocket_clients"), webSocket.getClients());
+  metrics.counter(F("websocket_dropped_total"), webSocket.getDropped());
+  metrics.gauge(F("wifi_rssi_dbm"), snapshot.rssi);
+}
 
-  b1.setup();
+/// GET /metrics
+void apiGetMetrics()
+{
+  MyIOT::ResponseStream out(webServer.getServer());
+  out.begin(200, PSTR("text/plain; version=0.0.4"));
+  printMetrics(out, MetricsSnapshot());
+}
 
-#define SUNRISE
-#if defined (SUNRISE)
-  sunrise.setup([](uint16_t value){
+void publishMetrics()
+{
+  if (!mqtt.isConnected()) return;
+  MetricsSnapshot snapshot; // "publish" prints twice
+  mqtt.publish("metrics", [&snapshot](Print& out){ printMetrics(out, snapshot); });
+}
 
-    uint8_t high = value>>8;
-    uint8_t low = 0xff & value;
+void printTrace(Print& out)
+{
+  MyIOT::Trace::instance().dump(out);
+}
 
-    uint8_t w = high;
-    uint8_t c = 0;
+/// GET /trace, the binary trace, see "MyIOT::Trace"
+void apiGetTrace()
+{
+  MyIOT::Trace::instance().setEnabled(false);
+  {
+    MyIOT::ResponseStream out(webServer.getServer());
+    out.begin(200, PSTR("application/octet-stream"));
+    printTrace(out);
+  }
+  MyIOT::Trace::instance().setEnabled(true);
+}
 
-    uint8_t r = 255;
-    if ( high < 0xF)
-    {
-       r =  (high<<4) | (low>>4);
-    }
+/// GET /api/status
+void apiGetStatus()
+{
+  StaticJsonBuffer<API_JSON_CAPACITY> jsonBuffer;
+  JsonObject& json = jsonBuffer.createObject();
+  IPAddress ip = WiFi.localIP();
+  char sip[16];
+  snprintf_P(sip, sizeof(sip), PSTR("%u.%u.%u.%u"), ip[0], ip[1], ip[2], ip[3]);
+  json["name"] = config.getDeviceName();
+  json["ip"] = sip;
+  json["rssi"] = WiFi.RSSI();
+  json["heap"] = ESP.getFreeHeap();
+  json["uptime"] = millis() / 1000;
+  json["mqtt"] = mqtt.isConnected();
+  webServer.sendJson(200, json);
+}
 
-    uint8_t g = 0;
-    uint8_t b = 0;
 
-    unsigned int values[] = {c,w,r,g,b};
-    b1.controlLeds(values, sizeof(values)/sizeof(values[0]) );
+/// network services need WiFi, they are started on the first connect
+void startNetworkServices()
+{
+  ota.setup(config.getDeviceName());
+  ota.setOnRestart([](){ store.flush(); });
+  mqtt.setup(config.getDeviceName(), config.getMqttServer());
+  mqtt.setGroup(config.getGroup());
+  webServer.setup(config);
+  webServer.setOnChange([](){
+    mqtt.reconnect(); // the device name or group may have changed
+    wallClock.setTimezone(config.getTimezone());
+    alarms.rebuild();
+    lightControl.reloadLightState(); // a sunrise or stream goes on, unless the light was changed
   });
-#endif
-
-  tsystem.add(&ota, MyIOT::TimerSystem::TimeSpec(0, 10e6));
-  tsystem.add(&webServer, MyIOT::TimerSystem::TimeSpec(0,10e6));
-  tsystem.add(&mqtt, MyIOT::TimerSystem::TimeSpec(0, 100e6));
-  tsystem.add(&sunrise, MyIOT::TimerSystem::TimeSpec(0, 100e6));
+  webServer.on("/api/state", HTTP_GET, apiGetState);
+  webServer.on("/api/state", HTTP_PUT, apiSetState);
+  webServer.on("/api/state", HTTP_POST, apiSetState);
+  webServer.on("/api/status", HTTP_GET, apiGetStatus);
+  webServer.on("/metrics", HTTP_GET, apiGetMetrics);
+  webServer.on("/trace", HTTP_GET, apiGetTrace);
+  ddp.setup();
+  webSocket.setup();
+
+  tsystem.add(&ota, MyIOT::TimerSystem::TimeSpec(0, 10e6), "ota");
+  tsystem.add(&httpUpdate, MyIOT::TimerSystem::TimeSpec(0, 1e6), "update");
+  tsystem.add(&webServer, MyIOT::TimerSystem::TimeSpec(0,10e6), "web");
+  tsystem.add(&mqtt, MyIOT::TimerSystem::TimeSpec(0, 100e6), "mqtt");
+  tsystem.add(&ddp, MyIOT::TimerSystem::TimeSpec(0, 5e6), "stream");
+  tsystem.add(&webSocket, MyIOT::TimerSystem::TimeSpec(0, 5e6), "websocket");
+  tsystem.add(webSocketStateUpdate, MyIOT::TimerSystem::TimeSpec(0, 50e6), "websocket_state");
+  tsystem.add(webSocketTelemetry, MyIOT::TimerSystem::TimeSpec(1, 0), "websocket_telemetry");
+  tsystem.add(publishMetrics, MyIOT::TimerSystem::TimeSpec(60, 0), "metrics");
+}
 
+void setup() {
+  Serial.begin(115200);
 
-  //mqtt.setOnConnected( [] () {mqtt.publish("system", "MQTT connected");});
+  watchdog.setup();
+  tsystem.set_observer(&watchdog);
 
-#if defined(TESTCHANNELS)
-  mqtt.subscribe("ch0", [](const char* message){ b1.updateChannel(0, ::atoi(message)); });
-  mqtt.subscribe("ch1", [](const char* message){ b1.updateChannel(1, ::atoi(message)); });
-  mqtt.subscribe("ch2", [](const char* message){ b1.updateChannel(2, ::atoi(message)); });
-  mqtt.subscribe("ch3", [](const char* message){ b1.updateChannel(3, ::atoi(message)); });
-  mqtt.subscribe("ch4", [](const char* message){ b1.updateChannel(4, ::atoi(message)); });
-  mqtt.subscribe("ch5", [](const char* message){ b1.updateChannel(5, ::atoi(message)); });
-#endif
-  mqtt.subscribe("control", [](const char* message){
-    sunrise.reset(); // no more sunrise !!
-    if (0 == strcasecmp("ON", message))
-    {
-	    message = colorConfig.getLedColors();
-	    colorConfig.setEnabled(true);
-    }
-    else if (0 == strcasecmp("OFF", message))
-    {
-	    message = "0";
-	    colorConfig.setEnabled(false);
-    }
-    else if (0 == strcasecmp("toggle", message))
-    {
-      if (colorConfig.getEnabled())
-      {
-        colorConfig.setEnabled(false);
-        message = "0";
-      }
-      else
-      {
-        colorConfig.setEnabled(true);
-        message = colorConfig.getLedColors();
-      }
-    }
-    else if (0 == strcasecmp("error", message))
-    {
-      b1.controlLeds("0,0,255,0,0");
-      return;
-    }
-    else
-    {
-      colorConfig.setLedColors(message);
-      colorConfig.setEnabled(true);
-    }
+  // instant on: show the light before anything slow happens
+  light.setup();
+  bool restored = light.restoreFrame(); // RTC memory, before the file system is mounted
+  store.setup();
+  lightState.setup(store.get());
+  if (!restored) // power cycle
+  {
+    lightControl.restoreLightState();
+    light.flush();
+  }
+  tsystem.add_first(&light, MyIOT::TimerSystem::TimeSpec(0, 5e6), "output");
+
+  config.setup(store);
+  wallClock.setup(config.getTimezone());
+  alarms.setup(tsystem, wallClock, store.get().alarms);
+  config.setOnConnected(startNetworkServices);
+  tsystem.add(&config, MyIOT::TimerSystem::TimeSpec(0, 100e6), "wifi");
+
+  // sunrise, transition, alarms, the command stage and the MQTT topics "control", "set", "sunrise" and "alarm"
+  lightControl.setup(tsystem);
+  lightControl.setStream([](){ return ddp.isActive(); });
+  tsystem.add(&store, MyIOT::TimerSystem::TimeSpec(1, 0), "config");
+
+  ddp.setChannelOffset(store.get().streamOffset);
+  ddp.setOnFrame([](const unsigned int* values, size_t length){
+    lightControl.showFrame(values, length); // the stream has priority
+  });
+  ddp.setOnTimeout([](){
+    char buffer[64];
+    snprintf_P(buffer, sizeof(buffer), PSTR("received=%lu invalid=%lu lost=%lu"), ddp.getReceived(), ddp.getInvalid(),
+               ddp.getLost());
+    mqtt.publish("stream", buffer);
+    lightControl.restoreLightState();
+  });
 
-    b1.controlLeds(message);
-    colorConfig.save();
+  webSocket.setOnText([](const char* message, size_t){
+    lightControl.submit(LightControl::CMD_CONTROL, message);
   });
-#if defined (SUNRISE)
-  mqtt.subscribe("sunrise", [](const char*message){
-    uint32_t dt = ::atoi(message);
-    if (dt > 0)
-    {
-      sunrise.start(dt);
-    }
-    else
+  webSocket.setOnBinary([](const uint8_t* data, size_t length){
+    // raw frame c,w,r,g,b, e.g. while a slider is dragged, it is not stored
+    unsigned int values[Light::NUMBER_OF_VALUES] = {0};
+    for (size_t i = 0; i < length && i < Light::NUMBER_OF_VALUES; i++)
     {
-      b1.controlLeds("0");
+      values[i] = data[i];
     }
+    lightControl.showFrame(values, Light::NUMBER_OF_VALUES);
+  });
+  webSocket.setOnConnected([](uint8_t client){
+    char buffer[128];
+    printLightState(buffer, sizeof(buffer));
+    webSocket.send(client, buffer);
   });
+
+#if defined(TESTCHANNELS)
+  mqtt.subscribe("ch0", [](const char* message){ light.updateChannel(0, ::atoi(message)); });
+  mqtt.subscribe("ch1", [](const char* message){ light.updateChannel(1, ::atoi(message)); });
+  mqtt.subscribe("ch2", [](const char* message){ light.updateChannel(2, ::atoi(message)); });
+  mqtt.subscribe("ch3", [](const char* message){ light.updateChannel(3, ::atoi(message)); });
+  mqtt.subscribe("ch4", [](const char* message){ light.updateChannel(4, ::atoi(message)); });
+  mqtt.subscribe("ch5", [](const char* message){ light.updateChannel(5, ::atoi(message)); });
 #endif
+  mqtt.subscribe("stream_offset", [](const char* message){
+    ddp.setChannelOffset(::atoi(message));
+    store.get().streamOffset = ddp.getChannelOffset();
+    store.save();
+  });
+  mqtt.subscribe("trace", [](const char*){
+    // the trace must not change between measuring and sending
+    MyIOT::Trace::instance().setEnabled(false);
+    mqtt.publish("trace/dump", printTrace);
+    MyIOT::Trace::instance().setEnabled(true);
+  });
 
-  b1.controlLeds(colorConfig.getEnabled() ? colorConfig.getLedColors(): "0");
+  // "<url> <md5>", progress is published on "update/progress", the other timers except MQTT are paused meanwhile
+  httpUpdate.setup(tsystem, &mqtt);
+  httpUpdate.setOnRestart([](){ store.flush(); });
+  httpUpdate.setOnProgress([](const char* status){
+    mqtt.publish("update/progress", status);
+  });
+  mqtt.subscribe("update", [](const char* message){
+    httpUpdate.start(message);
+  });
+
+  // fallback for the clock, if no SNTP server is reachable: ms since 1970
+  mqtt.subscribe("time", [](const char* message){
+    if (wallClock.setTime(strtoull(message, nullptr, 10))) alarms.rebuild();
+  });
 }
 
 void loop() {
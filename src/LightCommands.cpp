@@ -0,0 +1,81 @@
+/*
+ * LightCommands.cpp
+ *
+ *  Created on: 19.10.2026
+ */
+
+#include "LightCommands.h"
+
+namespace
+{
+/// the scenes are kept in flash, "findScene" copies the frame
+struct Scene
+{
+  char name[8];
+  char frame[LightCommands::FRAME_LENGTH];
+};
+
+const Scene scenes[] PROGMEM =
+{
+  {"white", "200,200,0,0,0"},
+  {"cold", "255,0,0,0,0"},
+  {"warm", "0,255,0,0,0"},
+  {"night", "0,20,10,0,0"},
+  {"red", "0,0,255,0,0"},
+};
+
+void copy (char* buffer, const char* text, size_t size)
+{
+  strncpy (buffer, text, size);
+  buffer[size - 1] = 0;
+}
+}
+
+bool LightCommands::findScene (const char* name, char* frame, size_t size)
+{
+  for (const Scene& scene : scenes)
+  {
+    if (name && 0 == strcasecmp_P (name, scene.name))
+    {
+      strncpy_P (frame, scene.frame, size);
+      frame[size - 1] = 0;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool LightCommands::isPowerCommand (const char* message)
+{
+  return 0 == strcasecmp ("ON", message) || 0 == strcasecmp ("OFF", message) || 0 == strcasecmp ("toggle", message);
+}
+
+bool LightCommands::mergeControl (char* pending, size_t size, const char* message)
+{
+  if ('@' == pending[0] || '@' == message[0])
+    return false; // timed commands stay apart
+  if (0 == strcasecmp ("toggle", message))
+  {
+    if (0 == strcasecmp ("ON", pending))
+      copy (pending, "OFF", size);
+    else if (0 == strcasecmp ("OFF", pending))
+      copy (pending, "ON", size);
+    else
+      return false;
+    return true;
+  }
+  if (isPowerCommand (message) && !isPowerCommand (pending))
+    return false;
+  if (0 == strcasecmp ("error", message))
+    return false;
+  copy (pending, message, size);
+  return true;
+}
+
+bool LightCommands::replaceCommand (char* pending, size_t size, const char* message)
+{
+  if ('@' == pending[0] || '@' == message[0])
+    return false; // timed commands stay apart
+  copy (pending, message, size);
+  return true;
+}
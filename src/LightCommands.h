@@ -0,0 +1,35 @@
+/*
+ * LightCommands.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_LIGHTCOMMANDS_H_
+#define SRC_LIGHTCOMMANDS_H_
+#include <Arduino.h>
+
+/// The parts of the "control" and "sunrise" commands, that don't depend on the state of the bulb.
+/* The scenes and the "CommandStage::F_Merge" rules are compiled once, so the firmware and the
+ * host soak test ("tools/host") use the same code.
+ * */
+class LightCommands
+{
+public:
+  enum {FRAME_LENGTH = 16};
+
+  /// copy the frame of the scene "name" into "frame", false for an unknown scene
+  static bool findScene (const char* name, char* frame, size_t size);
+
+  /// ON, OFF or toggle
+  static bool isPowerCommand (const char* message);
+
+  /// "CommandStage::F_Merge" of "control": a frame or scene replaces any waiting command, ON/OFF a power command
+  /* A toggle flips a waiting ON/OFF. Everything else is queued, e.g. OFF after a frame, so the frame is stored.
+   * */
+  static bool mergeControl (char* pending, size_t size, const char* message);
+
+  /// "CommandStage::F_Merge" of absolute commands, e.g. a sunrise: the latest one replaces a waiting one
+  static bool replaceCommand (char* pending, size_t size, const char* message);
+};
+
+#endif /* SRC_LIGHTCOMMANDS_H_ */
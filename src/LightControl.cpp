@@ -0,0 +1,330 @@
+/*
+ * LightControl.cpp
+ *
+ *  Created on: 19.10.2026
+ */
+
+#include "LightControl.h"
+#include "LightCommands.h"
+
+namespace
+{
+typedef MyIOT::TimerSystem::TimeSpec TimeSpec;
+}
+
+LightControl::LightControl (LightFrame& xlight, LightState& xlightState, Transition& xtransition, Sunrise& xsunrise,
+                            MyIOT::ConfigStore& xstore, MyIOT::Mqtt& xmqtt, const MyIOT::Clock& xwallClock,
+                            MyIOT::AlarmScheduler& xalarms, MyIOT::StallWatchdog& xwatchdog) :
+    light (xlight), lightState (xlightState), transition (xtransition), sunrise (xsunrise), store (xstore),
+    mqtt (xmqtt), wallClock (xwallClock), alarms (xalarms), watchdog (xwatchdog), pendingCount (0),
+    lightStateShown (false)
+{
+  memset (pending, 0, sizeof (pending));
+  memset (stateFrame, 0, sizeof (stateFrame));
+}
+
+void LightControl::setup (MyIOT::TimerSystem& tsystem)
+{
+  alarms.setOnAlarm ([this](const char* command){ alarmCommand (command); });
+
+  sunrise.setup ([this](uint16_t value){ showSunrise (value); });
+  tsystem.add (&sunrise, TimeSpec (0, 100e6), "sunrise");
+  transition.setup ([this](const unsigned int* values, size_t length){ light.controlLeds (values, length); });
+  tsystem.add (&transition, TimeSpec (0, 20e6), "transition");
+
+  // a flood of commands, e.g. from a slider, is coalesced into the waiting command, as long as the result
+  // is the same, otherwise queued; at most one is applied per frame
+  commands.setup (CMD_CONTROL, [this](const char* message){ dispatch (message, &LightControl::control); }, 10, 5,
+                  LightCommands::mergeControl);
+  commands.setup (CMD_SET, [this](const char* message){ dispatch (message, &LightControl::setCommand); }, 10, 5,
+                  LightState::merge);
+  commands.setup (CMD_SUNRISE, [this](const char* message){ dispatch (message, &LightControl::sunriseCommand); }, 1, 2,
+                  LightCommands::replaceCommand);
+  tsystem.add (&commands, TimeSpec (0, 20e6), "commands");
+  tsystem.add ([this](){ runPendingCommands (); }, TimeSpec (0, 2e6), "pending");
+
+  mqtt.setReady ([this](){ return commands.canAccept (); });
+  mqtt.setOnConnected ([this](){
+    publishLightState ();
+    // stalls since the last report, including the timer, that was running at a watchdog reset
+    if (0 == watchdog.count ()) return;
+    mqtt.publish ("stalls", [this](Print& out){ watchdog.print (out); });
+    watchdog.clear ();
+  });
+  mqtt.subscribe ("control", [this](const char* message){ commands.submit (CMD_CONTROL, message); });
+  mqtt.subscribe ("set", [this](const char* message){ commands.submit (CMD_SET, message); });
+  mqtt.subscribe ("sunrise", [this](const char* message){ commands.submit (CMD_SUNRISE, message); });
+  mqtt.subscribe ("alarm", [this](const char* message){ setAlarm (message); });
+}
+
+void LightControl::restoreLightState ()
+{
+  transition.reset ();
+  unsigned int frame[LightFrame::NUMBER_OF_VALUES];
+  lightState.compute (frame, LightState::ALL_CHANNELS);
+  light.controlLeds (frame, LightFrame::NUMBER_OF_VALUES);
+  memcpy (stateFrame, frame, sizeof (stateFrame));
+  lightStateShown = true;
+}
+
+void LightControl::applyLightState (uint8_t mask, uint32_t transitionMs)
+{
+  sunrise.reset (); // no more sunrise !!
+  if (!lightStateShown || transition.isRunning ())
+  {
+    mask = LightState::ALL_CHANNELS; // the leds show something else
+  }
+  if (0 == mask) return;
+
+  unsigned int frame[LightFrame::NUMBER_OF_VALUES];
+  memcpy (frame, light.getFrame (), sizeof (frame));
+  lightState.compute (frame, mask);
+  if (transitionMs > 0)
+  {
+    transition.start (light.getFrame (), frame, transitionMs);
+  }
+  else
+  {
+    transition.reset ();
+    light.controlChannels (frame, mask);
+  }
+  memcpy (stateFrame, frame, sizeof (stateFrame));
+  lightStateShown = true;
+  store.save ();
+  publishLightState ();
+}
+
+void LightControl::reloadLightState ()
+{
+  lightState.setup (store.get ()); // migrates an imported "ledColors"
+  unsigned int frame[LightFrame::NUMBER_OF_VALUES];
+  lightState.compute (frame, LightState::ALL_CHANNELS);
+  uint8_t mask = 0;
+  for (size_t i = 0; i < LightFrame::NUMBER_OF_VALUES; i++)
+  {
+    if (frame[i] != stateFrame[i]) mask |= 1 << i;
+  }
+  if (0 != mask) applyLightState (mask, 0);
+}
+
+void LightControl::control (const char* message, uint32_t transitionMs)
+{
+  uint8_t mask = 0;
+  if (0 == strcasecmp ("ON", message))
+  {
+    mask = lightState.setPower (true);
+  }
+  else if (0 == strcasecmp ("OFF", message))
+  {
+    mask = lightState.setPower (false);
+  }
+  else if (0 == strcasecmp ("toggle", message))
+  {
+    mask = lightState.setPower (!lightState.getPower ());
+  }
+  else if (0 == strcasecmp ("error", message))
+  {
+    sunrise.reset ();
+    transition.reset ();
+    light.controlLeds ("0,0,255,0,0");
+    lightStateShown = false;
+    return;
+  }
+  else
+  {
+    char frame[LightCommands::FRAME_LENGTH];
+    unsigned int values[LightFrame::NUMBER_OF_VALUES];
+    LightFrame::parseFrame (LightCommands::findScene (message, frame, sizeof (frame)) ? frame : message, values,
+                            LightFrame::NUMBER_OF_VALUES);
+    mask = lightState.setFrame (values);
+  }
+  applyLightState (mask, transitionMs);
+}
+
+void LightControl::startSunrise (uint32_t seconds)
+{
+  transition.reset ();
+  lightStateShown = false;
+  if (seconds > 0)
+  {
+    sunrise.start (seconds);
+  }
+  else
+  {
+    light.controlLeds ("0");
+  }
+  publishLightState ();
+}
+
+void LightControl::showFrame (const unsigned int* values, size_t length)
+{
+  sunrise.reset ();
+  transition.reset ();
+  lightStateShown = false;
+  light.controlLeds (values, length);
+}
+
+void LightControl::publishLightState ()
+{
+  mqtt.publish ("state", [this](Print& out){ lightState.printJson (out, currentEffect ()); }, true);
+}
+
+const char* LightControl::currentEffect () const
+{
+  if (sunrise.isRunning ()) return "sunrise";
+  if (streamActive && streamActive ()) return "stream";
+  return "none";
+}
+
+void LightControl::printAlarms (Print& out) const
+{
+  for (size_t i = 0; i < MyIOT::ConfigRecord::MAX_ALARMS; i++)
+  {
+    const char* alarm = store.get ().alarms[i];
+    if (0 == alarm[0]) continue;
+    out.print (i);
+    out.print (' ');
+    out.println (alarm);
+  }
+}
+
+void LightControl::printMetrics (MyIOT::MetricsWriter& metrics) const
+{
+  metrics.counter (F("mqtt_messages_in_total"), mqtt.get_messages_in ());
+  metrics.counter (F("mqtt_messages_out_total"), mqtt.get_messages_out ());
+  metrics.counter (F("mqtt_connects_total"), mqtt.get_connects ());
+  metrics.counter (F("led_updates_total"), light.getUpdates ());
+  metrics.gauge (F("led_frames_per_second"), light.getFramesPerSecond ());
+  metrics.counter (F("config_writes_total"), store.getWrites ());
+  metrics.counter (F("commands_total"), commands.getSubmitted ());
+  metrics.counter (F("commands_coalesced_total"), commands.getCoalesced ());
+  metrics.counter (F("commands_dropped_total"), commands.getDropped ());
+  metrics.counter (F("commands_applied_total"), commands.getApplied ());
+  metrics.counter (F("alarms_total"), alarms.getRuns ());
+}
+
+bool LightControl::isBusy () const
+{
+  return transition.isRunning () || pendingCount > 0
+      || commands.getSubmitted () != commands.getApplied () + commands.getCoalesced () + commands.getDropped ();
+}
+
+void LightControl::sunriseCommand (const char* message, uint32_t)
+{
+  startSunrise (::atoi (message));
+}
+
+void LightControl::setCommand (const char* message, uint32_t transitionMs)
+{
+  char buffer[256];
+  MyIOT::ConfigStore::setString (buffer, message, sizeof (buffer)); // parsed in place, without copies
+  StaticJsonBuffer<LightState::JSON_CAPACITY> jsonBuffer;
+  JsonObject& json = jsonBuffer.parseObject (buffer);
+  if (!json.success ())
+  {
+    Serial.println (F("set: invalid JSON"));
+    return;
+  }
+  const char* effect = json["effect"];
+  if (effect && 0 == strcasecmp ("sunrise", effect))
+  {
+    startSunrise (json["transition"].as<unsigned long> ());
+    return;
+  }
+  uint8_t mask = lightState.apply (json, transitionMs);
+  applyLightState (mask, transitionMs);
+}
+
+/* A group of bulbs, that gets the same start time, fades in sync. Without a synchronized clock
+ * or if the start time has passed already, the command is executed immediately.
+ * */
+void LightControl::dispatch (const char* message, F_Command execute)
+{
+  if ('@' != message[0])
+  {
+    (this->*execute) (message, 0);
+    return;
+  }
+  char* rest = nullptr;
+  uint64_t startMs = strtoull (message + 1, &rest, 10);
+  uint32_t transitionMs = (',' == *rest) ? strtoul (rest + 1, &rest, 10) : 0;
+  while (' ' == *rest) rest++;
+
+  if (!wallClock.isSynchronized () || startMs <= wallClock.now_ms ())
+  {
+    (this->*execute) (rest, transitionMs);
+    return;
+  }
+  if (pendingCount >= MAX_PENDING)
+  {
+    Serial.print (F("timed command rejected: "));
+    Serial.println (rest);
+    return;
+  }
+  // insertion sort, the same start time keeps the order of arrival
+  size_t pos = pendingCount++;
+  for (; pos > 0 && pending[pos - 1].startMs > startMs; pos--)
+  {
+    pending[pos] = pending[pos - 1];
+  }
+  pending[pos].startMs = startMs;
+  pending[pos].transitionMs = transitionMs;
+  pending[pos].execute = execute;
+  MyIOT::ConfigStore::setString (pending[pos].message, rest, sizeof (pending[pos].message));
+}
+
+void LightControl::runPendingCommands ()
+{
+  while (pendingCount > 0 && pending[0].startMs <= wallClock.now_ms ())
+  {
+    PendingCommand command = pending[0];
+    pendingCount--;
+    memmove (pending, pending + 1, pendingCount * sizeof (pending[0]));
+    (this->*command.execute) (command.message, command.transitionMs);
+  }
+}
+
+void LightControl::alarmCommand (const char* command)
+{
+  if (0 == strncasecmp (command, "sunrise ", 8))
+  {
+    startSunrise (::atoi (command + 8));
+  }
+  else
+  {
+    control (command, 0);
+  }
+}
+
+void LightControl::setAlarm (const char* message)
+{
+  char* alarm = nullptr;
+  unsigned long index = strtoul (message, &alarm, 10);
+  if (alarm == message || index >= MyIOT::ConfigRecord::MAX_ALARMS) return;
+  while (' ' == *alarm) alarm++;
+  MyIOT::ConfigStore::setString (store.get ().alarms[index], alarm, MyIOT::ConfigRecord::ALARM_LENGTH);
+  store.save ();
+  alarms.rebuild ();
+  mqtt.publish ("alarms", [this](Print& out){ printAlarms (out); });
+}
+
+void LightControl::showSunrise (uint16_t value)
+{
+  uint8_t high = value >> 8;
+  uint8_t low = 0xff & value;
+
+  uint8_t w = high;
+  uint8_t c = 0;
+
+  uint8_t r = 255;
+  if (high < 0xF)
+  {
+    r = (high << 4) | (low >> 4);
+  }
+
+  uint8_t g = 0;
+  uint8_t b = 0;
+
+  unsigned int values[] = {c, w, r, g, b};
+  light.controlLeds (values, sizeof (values) / sizeof (values[0]));
+}
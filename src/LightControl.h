@@ -0,0 +1,144 @@
+/*
+ * LightControl.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_LIGHTCONTROL_H_
+#define SRC_LIGHTCONTROL_H_
+#include <Arduino.h>
+#include "LightFrame.h"
+#include "LightState.h"
+#include "Sunrise.h"
+#include "Transition.h"
+#include "myiot_ConfigStore.h"
+#include "myiot_alarmScheduler.h"
+#include "myiot_clock.h"
+#include "myiot_commandStage.h"
+#include "myiot_metrics.h"
+#include "myiot_mqtt.h"
+#include "myiot_stallWatchdog.h"
+#include "myiot_timer_system.h"
+
+/// What the bulb does with a command: the MQTT topics "control", "set", "sunrise" and "alarm", alarms and effects.
+/* The glue between the command stage, the light state, sunrise, transition and the output, compiled once,
+ * so the firmware and the host soak test ("tools/host") run the same code. The output is any "LightFrame",
+ * the led driver doesn't matter here. "setup" adds the timers and the MQTT subscriptions.
+ * */
+class LightControl
+{
+public:
+  /// targets of the "CommandStage", the commands of one target are applied in order
+  enum {CMD_CONTROL, CMD_SET, CMD_SUNRISE};
+  /// commands, that wait for their start time
+  enum {MAX_PENDING = 4};
+
+  typedef MyIOT::Function<bool()> F_IsActive;
+
+  LightControl (LightFrame& light, LightState& lightState, Transition& transition, Sunrise& sunrise,
+                MyIOT::ConfigStore& store, MyIOT::Mqtt& mqtt, const MyIOT::Clock& wallClock,
+                MyIOT::AlarmScheduler& alarms, MyIOT::StallWatchdog& watchdog);
+
+  /// after "alarms.setup", the light state is set up and shown already
+  void setup (MyIOT::TimerSystem& tsystem);
+
+  /// "isActive" tells, whether the leds show a stream, see "currentEffect"
+  void setStream (const F_IsActive& isActive) { streamActive = isActive; }
+
+  /// queue a command for "target", e.g. from the WebSocket
+  bool submit (size_t target, const char* message) { return commands.submit (target, message); }
+
+  /// show the state, that was set by the last command
+  void restoreLightState ();
+
+  /// show the channels in "mask", that changed in the light state, faded within "transitionMs", and store the state
+  void applyLightState (uint8_t mask, uint32_t transitionMs);
+
+  /// set up the light state again, after the record was changed by something else than a command, e.g. an import
+  /* Only the channels, that changed, are shown, a sunrise or a stream continues, if the light didn't change.
+   * */
+  void reloadLightState ();
+
+  /// handle a "control" command: ON, OFF, toggle, error, a scene or a frame c,w,r,g,b
+  void control (const char* message, uint32_t transitionMs);
+
+  /// "seconds" 0 stops a sunrise
+  void startSunrise (uint32_t seconds);
+
+  /// show a frame, that is not stored, e.g. of a stream or a slider, until the next command
+  void showFrame (const unsigned int* values, size_t length);
+
+  /// retained, so a controller gets the state as soon as it subscribes
+  void publishLightState ();
+
+  /// the effect, that shows something else than the light state: "sunrise", "stream" or "none"
+  const char* currentEffect () const;
+
+  /// one line per alarm: "<index> <days> <hh:mm> <command>"
+  void printAlarms (Print& out) const;
+
+  /// the counters of MQTT, the output, the config store, the commands and the alarms
+  void printMetrics (MyIOT::MetricsWriter& metrics) const;
+
+  /// a command waits for its turn or its start time, or a transition runs
+  bool isBusy () const;
+
+  const MyIOT::CommandStage& getCommands () const { return commands; }
+
+private:
+  /// handler of a command, that can be delayed, see "dispatch"
+  typedef void (LightControl::*F_Command) (const char* message, uint32_t transitionMs);
+
+  /// A command, that waits for its start time.
+  struct PendingCommand
+  {
+    uint64_t startMs;
+    uint32_t transitionMs;
+    F_Command execute;
+    char message[128];
+  };
+
+  /// "sunrise" command: duration in seconds, 0 stops it
+  void sunriseCommand (const char* message, uint32_t transitionMs);
+
+  /// "set" command: JSON, see "LightState::apply", {"effect": "sunrise", "transition": seconds} starts a sunrise
+  void setCommand (const char* message, uint32_t transitionMs);
+
+  /// execute "message" now, or at the start time given by a prefix "@<ms since 1970>[,<transition ms>] "
+  /* Up to "MAX_PENDING" commands wait, ordered by their start time, a command beyond is rejected.
+   * */
+  void dispatch (const char* message, F_Command execute);
+
+  /// execute the commands, whose start time has come
+  void runPendingCommands ();
+
+  /// command of an alarm: "sunrise <seconds>" or a "control" command, e.g. a scene
+  void alarmCommand (const char* command);
+
+  /// "<index> <days> <hh:mm> <command>" sets, "<index>" removes an alarm
+  void setAlarm (const char* message);
+
+  void showSunrise (uint16_t value);
+
+  LightFrame& light;
+  LightState& lightState;
+  Transition& transition;
+  Sunrise& sunrise;
+  MyIOT::ConfigStore& store;
+  MyIOT::Mqtt& mqtt;
+  const MyIOT::Clock& wallClock;
+  MyIOT::AlarmScheduler& alarms;
+  MyIOT::StallWatchdog& watchdog;
+  MyIOT::CommandStage commands;
+  F_IsActive streamActive;
+  PendingCommand pending[MAX_PENDING];
+  size_t pendingCount;
+
+  /// the frame of the light state, that was shown last
+  unsigned int stateFrame[LightFrame::NUMBER_OF_VALUES];
+
+  /// false, while the leds show something else than the light state, e.g. a sunrise or a stream
+  bool lightStateShown;
+};
+
+#endif /* SRC_LIGHTCONTROL_H_ */
@@ -0,0 +1,87 @@
+/*
+ * LightDrivers.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_LIGHTDRIVERS_H_
+#define SRC_LIGHTDRIVERS_H_
+#include <Arduino.h>
+#include <my92xx.h>
+
+/* Driver policies for "LightOutput". A driver has no virtual methods, it needs
+ *   void setup();
+ *   void setChannel(unsigned char channel, unsigned int value);
+ *   void update();   // show the values set by "setChannel"
+ * */
+
+/// Maps the values of a frame (c, w, r, g, b) to the channels of the driver.
+template <unsigned char COLD, unsigned char WARM, unsigned char RED, unsigned char GREEN, unsigned char BLUE>
+struct ChannelMap
+{
+  static constexpr unsigned char channel(size_t index)
+  {
+    return 0 == index ? COLD : 1 == index ? WARM : 2 == index ? RED : 3 == index ? GREEN : BLUE;
+  }
+};
+
+/// Chained "my9231" or "my9291" led drivers, e.g. SONOFF B1 or AiLight.
+template <unsigned char DI_PIN, unsigned char DCKI_PIN, unsigned char CHIPS = 2, my92xx_model_t MODEL = MY92XX_MODEL_MY9231>
+class My92xxDriver
+{
+public:
+  void setup()
+  {
+    leds = new my92xx(MODEL, CHIPS, DI_PIN, DCKI_PIN, MY92XX_COMMAND_DEFAULT);
+    leds->setState(true);
+  }
+
+  void setChannel(unsigned char channel, unsigned int value) { leds->setChannel(channel, value); }
+  void update() { leds->update(); }
+
+private:
+  my92xx* leds = nullptr;
+};
+
+/// One PWM pin per channel, channel "i" is the i-th pin of "PINS".
+/* The range is 0..255, like the one of the my92xx drivers.
+ * */
+template <uint8_t... PINS>
+class PwmDriver
+{
+public:
+  enum {CHANNELS = sizeof...(PINS), RANGE = 255};
+
+  void setup()
+  {
+    analogWriteRange(RANGE);
+    for (size_t i = 0; i < CHANNELS; i++)
+    {
+      pinMode(pin(i), OUTPUT);
+    }
+  }
+
+  void setChannel(unsigned char channel, unsigned int value)
+  {
+    if (channel < CHANNELS) values[channel] = value > RANGE ? RANGE : value;
+  }
+
+  void update()
+  {
+    for (size_t i = 0; i < CHANNELS; i++)
+    {
+      analogWrite(pin(i), values[i]);
+    }
+  }
+
+private:
+  static uint8_t pin(size_t channel)
+  {
+    static const uint8_t pins[] = {PINS...};
+    return pins[channel];
+  }
+
+  unsigned int values[CHANNELS] = {0};
+};
+
+#endif /* SRC_LIGHTDRIVERS_H_ */
@@ -0,0 +1,101 @@
+/*
+ * LightFrame.cpp
+ *
+ *  Created on: 19.10.2026
+ */
+
+#include "LightFrame.h"
+#include "myiot_crc32.h"
+
+namespace
+{
+  const uint32_t RTC_FRAME_MAGIC = 0x42314652; // "B1FR"
+}
+
+void LightFrame::parseFrame (const char* message, unsigned int* values, size_t length)
+{
+  for (size_t i = 0; i < length; i++)
+  {
+    values[i] = 0;
+  }
+  char buffer[5];
+  size_t tmpIdx = 0;
+  size_t valIdx = 0;
+  for (; 0 != message; message++)
+  {
+    if (',' == *message || '\0' == *message)
+    {
+      buffer[tmpIdx] = 0;
+      tmpIdx = 0;
+      if (valIdx < length)
+      {
+        values[valIdx++] = ::atoi (buffer);
+      }
+      else
+      {
+        break; // no more space in values array
+      }
+      if ('\0' == *message)
+      {
+        break;
+      }
+    }
+    else if (tmpIdx < (sizeof(buffer) / sizeof(buffer[0])) - 1)
+    {
+      buffer[tmpIdx++] = *message;
+    }
+  }
+}
+
+uint8_t LightFrame::setFrame (const unsigned int* values, size_t length)
+{
+  uint8_t mask = 0;
+  for (size_t i = 0; i < NUMBER_OF_VALUES && i < length; i++)
+  {
+    if (frame[i] != values[i])
+    {
+      frame[i] = values[i];
+      mask |= 1 << i;
+    }
+  }
+  return mask;
+}
+
+void LightFrame::measureRate ()
+{
+  unsigned long now = millis ();
+  if (now - windowStart >= 1000)
+  {
+    framesPerSecond = updates - windowUpdates;
+    windowUpdates = updates;
+    windowStart = now;
+  }
+}
+
+void LightFrame::saveFrame () const
+{
+  RtcFrame rtcFrame;
+  memset (&rtcFrame, 0, sizeof(rtcFrame));
+  rtcFrame.magic = RTC_FRAME_MAGIC;
+  for (size_t i = 0; i < NUMBER_OF_VALUES; i++)
+  {
+    rtcFrame.values[i] = frame[i];
+  }
+  rtcFrame.crc = MyIOT::crc32 (rtcFrame.values, sizeof(rtcFrame.values));
+  ESP.rtcUserMemoryWrite (RTC_FRAME_BLOCK, reinterpret_cast<uint32_t*> (&rtcFrame), sizeof(rtcFrame));
+}
+
+bool LightFrame::loadFrame (unsigned int* values)
+{
+  RtcFrame rtcFrame;
+  if (!ESP.rtcUserMemoryRead (RTC_FRAME_BLOCK, reinterpret_cast<uint32_t*> (&rtcFrame), sizeof(rtcFrame)))
+    return false;
+  if (RTC_FRAME_MAGIC != rtcFrame.magic || rtcFrame.crc != MyIOT::crc32 (rtcFrame.values, sizeof(rtcFrame.values)))
+    return false; // power cycle, RTC memory is lost
+
+  for (size_t i = 0; i < NUMBER_OF_VALUES; i++)
+  {
+    values[i] = rtcFrame.values[i];
+  }
+  return true;
+}
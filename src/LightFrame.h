@@ -0,0 +1,95 @@
+/*
+ * LightFrame.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_LIGHTFRAME_H_
+#define SRC_LIGHTFRAME_H_
+#include <Arduino.h>
+
+/// The frame (c, w, r, g, b) of a bulb, independent of its led driver.
+/* Parsing, changing and keeping the frame in RTC memory is the same for every bulb,
+ * so it is compiled once, see "LightOutput" for the driver specific part.
+ * The "control" functions only write the frame and mark the changed channels, "LightOutput" pushes them.
+ * */
+class LightFrame
+{
+public:
+  enum {NUMBER_OF_VALUES = 5};
+
+  void controlLeds(const char* message)
+  {
+    unsigned int values[NUMBER_OF_VALUES];
+    parseFrame(message, values, NUMBER_OF_VALUES);
+    controlLeds(values, NUMBER_OF_VALUES);
+  }
+
+  // (c, w, r, g b)  // cold, warm, red, green, blue
+  void controlLeds(const unsigned int* values, size_t length)
+  {
+    dirty |= setFrame(values, length);
+  }
+
+  /// show a frame, where only the channels in "mask" (bit 0 is c, ... bit 4 is b) changed
+  void controlChannels(const unsigned int* values, uint8_t mask)
+  {
+    for (size_t i = 0; i < NUMBER_OF_VALUES; i++)
+    {
+      if (mask & (1 << i)) frame[i] = values[i];
+    }
+    dirty |= mask;
+  }
+
+  void controlLeds(unsigned int cold, unsigned int warm, unsigned int red, unsigned int green, unsigned int blue)
+  {
+    unsigned int values[] = { cold, warm, red, green, blue };
+    controlLeds(values, sizeof(values) / sizeof(values[0]));
+  }
+
+  /// the values (c, w, r, g, b) shown at the moment, or with the next push to the led drivers
+  const unsigned int* getFrame () const { return frame; }
+
+  /// number of frames sent to the led drivers
+  unsigned long getUpdates () const { return updates; }
+
+  /// frames sent to the led drivers within the last second
+  unsigned long getFramesPerSecond () const { return framesPerSecond; }
+
+  /// parse "c,w,r,g,b" into "values", missing values are 0
+  static void parseFrame (const char* message, unsigned int* values, size_t length);
+
+protected:
+  /// RTC memory block of the last frame, the first 32 blocks are used by OTA
+  const static uint32_t RTC_FRAME_BLOCK = 32;
+
+  /// store "values" as the current frame, returns the mask of the changed channels (bit 0 is c)
+  uint8_t setFrame (const unsigned int* values, size_t length);
+
+  /// keep the current frame in RTC memory
+  void saveFrame () const;
+
+  /// update "framesPerSecond" once per second
+  void measureRate ();
+
+  /// the last frame from RTC memory, false after a power cycle
+  static bool loadFrame (unsigned int* values);
+
+  unsigned int frame[NUMBER_OF_VALUES] = {0};
+  uint8_t dirty = 0; // channels, that changed since the last push
+  unsigned long updates = 0;
+  unsigned long framesPerSecond = 0;
+  unsigned long windowStart = 0;
+  unsigned long windowUpdates = 0;
+
+private:
+  struct RtcFrame
+  {
+    uint32_t magic;
+    uint32_t crc;
+    uint16_t values[NUMBER_OF_VALUES];
+    uint16_t reserved;
+  };
+};
+
+#endif /* SRC_LIGHTFRAME_H_ */
@@ -0,0 +1,78 @@
+/*
+ * LightOutput.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_LIGHTOUTPUT_H_
+#define SRC_LIGHTOUTPUT_H_
+#include "LightFrame.h"
+#include "myiot_timer_system.h"
+#include "myiot_trace.h"
+
+/// Shows frames (c, w, r, g, b) with the led driver "Driver", see "LightDrivers.h".
+/* The driver and the channel map are template parameters, so every firmware image
+ * calls its driver directly, without virtual calls or a runtime channel table.
+ *
+ * The frame is double buffered: "controlLeds" only writes the next frame and marks the changed channels,
+ * "expire" pushes it to the driver. Add the output with "TimerSystem::add_first", so it runs first in every loop
+ * and a burst of commands becomes one short, bounded transfer per tick instead of one per callback.
+ * */
+template <typename Driver, typename Channels>
+class LightOutput : public LightFrame, public MyIOT::ITimer
+{
+public:
+  void setup()
+  {
+    driver.setup();
+  }
+
+  /// set a channel of the driver, without mapping, e.g. to find out the channel map of a bulb
+  void updateChannel(unsigned char channel, unsigned int value)
+  {
+    driver.setChannel(channel, value);
+    driver.update();
+  }
+
+  /// show the last frame again, if it survived the reset in RTC memory
+  bool restoreFrame()
+  {
+    unsigned int values[NUMBER_OF_VALUES];
+    if (!loadFrame(values)) return false;
+    controlLeds(values, NUMBER_OF_VALUES);
+    flush();
+    return true;
+  }
+
+  /// push a changed frame now, e.g. before the timer system runs
+  void flush()
+  {
+    if (0 == dirty) return;
+    uint8_t mask = dirty;
+    dirty = 0;
+    for (size_t i = 0; i < NUMBER_OF_VALUES; i++)
+    {
+      if (mask & (1 << i)) driver.setChannel(Channels::channel(i), frame[i]);
+    }
+    MYIOT_TRACE(MyIOT::TRACE_LED_UPDATE_BEGIN, updates);
+    driver.update();
+    MYIOT_TRACE(MyIOT::TRACE_LED_UPDATE_END, updates);
+    updates++;
+    saveFrame();
+  }
+
+  virtual void expire()
+  {
+    flush();
+    measureRate();
+  }
+
+  virtual void destroy(){}
+
+  Driver& getDriver() { return driver; }
+
+private:
+  Driver driver;
+};
+
+#endif /* SRC_LIGHTOUTPUT_H_ */
@@ -0,0 +1,348 @@
+/*
+ * LightState.cpp
+ *
+ *  Created on: 19.10.2026
+ */
+
+#include "LightState.h"
+#include "LightFrame.h"
+
+namespace
+{
+/// merge "key" and "stepKey" of "next" into "pending", the value is clamped like the setters do, step by step
+/* Two steps without a value are only added up in the same direction, otherwise the clamping
+ * in between (e.g. +10 at 250, then -10) would make the sum differ from applying them one after the other.
+ * */
+bool mergeValue (JsonObject& pending, JsonObject& next, const char* key, const char* stepKey, int low, int high)
+{
+  if (next.containsKey (key))
+  {
+    int value = next[key].as<int> ();
+    if (next.containsKey (stepKey))
+      value = constrain (constrain (value, low, high) + next[stepKey].as<int> (), low, high);
+    pending[key] = value;
+    pending.remove (stepKey);
+  }
+  else if (next.containsKey (stepKey))
+  {
+    int step = next[stepKey].as<int> ();
+    if (pending.containsKey (key))
+    {
+      int value = constrain (pending[key].as<int> (), low, high);
+      if (pending.containsKey (stepKey))
+        value = constrain (value + pending[stepKey].as<int> (), low, high);
+      pending[key] = constrain (value + step, low, high);
+      pending.remove (stepKey);
+    }
+    else
+    {
+      int before = pending[stepKey].as<int> ();
+      if ((before < 0 && step > 0) || (before > 0 && step < 0))
+        return false;
+      pending[stepKey] = before + step;
+    }
+  }
+  return true;
+}
+}
+
+LightState::LightState () : record (nullptr)
+{
+}
+
+void LightState::setup (MyIOT::ConfigRecord& xrecord)
+{
+  record = &xrecord;
+  if (0 == record->lightMode || record->lightMode > FRAME)
+  {
+    unsigned int values[NUMBER_OF_VALUES];
+    LightFrame::parseFrame (record->ledColors, values, NUMBER_OF_VALUES);
+    bool power = record->enabled;
+    record->colorTemp = (MIN_MIREDS + MAX_MIREDS) / 2;
+    setFrame (values);
+    record->enabled = power;
+  }
+}
+
+uint8_t LightState::setPower (bool power)
+{
+  if (power == getPower ())
+    return 0;
+  record->enabled = power;
+  return ALL_CHANNELS;
+}
+
+uint8_t LightState::setBrightness (int brightness)
+{
+  brightness = constrain (brightness, 0, 255);
+  uint8_t mask = setPower (true);
+  if (brightness == record->brightness)
+    return mask;
+  record->brightness = brightness;
+  return mask | activeChannels ();
+}
+
+uint8_t LightState::setColorTemp (int mireds)
+{
+  mireds = constrain (mireds, int (MIN_MIREDS), int (MAX_MIREDS));
+  uint8_t mask = setPower (true) | setMode (COLOR_TEMP);
+  if (mireds == record->colorTemp)
+    return mask;
+  record->colorTemp = mireds;
+  return mask | WHITE_CHANNELS;
+}
+
+uint8_t LightState::setColor (uint8_t red, uint8_t green, uint8_t blue)
+{
+  uint8_t mask = setPower (true) | setMode (RGB);
+  uint8_t color[] = { red, green, blue };
+  for (size_t i = 0; i < sizeof(color); i++)
+  {
+    if (record->levels[2 + i] != color[i])
+    {
+      record->levels[2 + i] = color[i];
+      mask |= 1 << (2 + i);
+    }
+  }
+  return mask;
+}
+
+uint8_t LightState::setFrame (const unsigned int* values)
+{
+  unsigned int before[NUMBER_OF_VALUES];
+  for (size_t i = 0; i < NUMBER_OF_VALUES; i++)
+  {
+    before[i] = channel (i);
+  }
+  unsigned int brightness = 0;
+  for (size_t i = 0; i < NUMBER_OF_VALUES; i++)
+  {
+    if (values[i] > brightness)
+      brightness = values[i];
+  }
+  if (brightness > 0)
+  {
+    for (size_t i = 0; i < NUMBER_OF_VALUES; i++)
+    {
+      record->levels[i] = min (255u, values[i] * 255 / brightness);
+    }
+  }
+  record->brightness = min (255u, brightness);
+  uint8_t mask = setPower (true) | setMode (FRAME);
+  for (size_t i = 0; i < NUMBER_OF_VALUES; i++)
+  {
+    if (channel (i) != before[i])
+      mask |= 1 << i;
+  }
+  return mask;
+}
+
+uint8_t LightState::activeChannels () const
+{
+  switch (getColorMode ())
+  {
+  case COLOR_TEMP:
+    return WHITE_CHANNELS;
+  case RGB:
+    return COLOR_CHANNELS;
+  default:
+    return ALL_CHANNELS;
+  }
+}
+
+uint8_t LightState::setMode (ColorMode mode)
+{
+  if (mode == getColorMode ())
+    return 0;
+  record->lightMode = mode;
+  return ALL_CHANNELS;
+}
+
+uint8_t LightState::apply (JsonObject& json, uint32_t& transitionMs)
+{
+  uint8_t mask = 0;
+  if (json.containsKey ("transition"))
+  {
+    transitionMs = json["transition"].as<float> () * 1000;
+  }
+  if (json.containsKey ("color_temp"))
+  {
+    mask |= setColorTemp (json["color_temp"].as<int> ());
+  }
+  if (json.containsKey ("color_temp_step"))
+  {
+    mask |= setColorTemp (getColorTemp () + json["color_temp_step"].as<int> ());
+  }
+  if (json["color"].is<JsonObject&> ())
+  {
+    JsonObject& color = json["color"].as<JsonObject&> ();
+    mask |= setColor (color["r"].as<uint8_t> (), color["g"].as<uint8_t> (), color["b"].as<uint8_t> ());
+  }
+  if (json.containsKey ("brightness"))
+  {
+    mask |= setBrightness (json["brightness"].as<int> ());
+  }
+  if (json.containsKey ("brightness_step"))
+  {
+    mask |= setBrightness (getBrightness () + json["brightness_step"].as<int> ());
+  }
+  const char* state = json["state"];
+  if (state)
+  {
+    mask |= setPower (0 == strcasecmp ("TOGGLE", state) ? !getPower () : 0 == strcasecmp ("ON", state));
+  }
+  return mask;
+}
+
+bool LightState::merge (char* pending, size_t size, const char* message)
+{
+  if ('@' == pending[0] || '@' == message[0])
+    return false; // timed commands stay apart
+  char pendingCopy[MAX_COMMAND_LENGTH];
+  char messageCopy[MAX_COMMAND_LENGTH];
+  if (strlen (pending) >= sizeof(pendingCopy) || strlen (message) >= sizeof(messageCopy))
+    return false;
+  strcpy (pendingCopy, pending);
+  strcpy (messageCopy, message);
+
+  StaticJsonBuffer<JSON_CAPACITY + JSON_OBJECT_SIZE(2)> pendingBuffer;
+  StaticJsonBuffer<JSON_CAPACITY> messageBuffer;
+  JsonObject& p = pendingBuffer.parseObject (pendingCopy);
+  JsonObject& n = messageBuffer.parseObject (messageCopy);
+  if (!p.success () || !n.success () || p.size () + n.size () > 8)
+    return false; // the merged command must fit into "JSON_CAPACITY"
+
+  static const char* const known[] = { "state", "brightness", "brightness_step", "color_temp", "color_temp_step",
+                                       "color", "transition" };
+  bool changesLight = false;
+  for (JsonObject::iterator it = n.begin (); it != n.end (); ++it)
+  {
+    size_t i = 0;
+    while (i < sizeof(known) / sizeof(known[0]) && 0 != strcmp (known[i], it->key))
+      i++;
+    if (i == sizeof(known) / sizeof(known[0]))
+      return false; // e.g. "effect"
+    changesLight = changesLight || (i > 0 && i < 6);
+  }
+  if (p.containsKey ("effect"))
+    return false;
+  // "color_temp" after "color" switches the mode back, merged "color" would win
+  if (p.containsKey ("color") && (n.containsKey ("color_temp") || n.containsKey ("color_temp_step")))
+    return false;
+
+  const char* state = n["state"];
+  if (state && 0 == strcasecmp ("TOGGLE", state))
+  {
+    const char* before = p["state"];
+    if (!before || 0 == strcasecmp ("TOGGLE", before))
+      return false; // the result depends on the current state
+    state = 0 == strcasecmp ("ON", before) ? "OFF" : "ON";
+  }
+  if (state)
+    p["state"] = state;
+  else if (changesLight && p.containsKey ("state"))
+    p["state"] = "ON"; // the setters switch on
+
+  if (!mergeValue (p, n, "brightness", "brightness_step", 0, 255)
+      || !mergeValue (p, n, "color_temp", "color_temp_step", MIN_MIREDS, MAX_MIREDS))
+    return false;
+  if (n.containsKey ("color"))
+    p["color"] = n["color"];
+  // the later command decides, whether the result fades, without a transition it is shown at once
+  if (n.containsKey ("transition"))
+    p["transition"] = n["transition"];
+  else
+    p.remove ("transition");
+
+  if (p.measureLength () >= size)
+    return false;
+  p.printTo (pending, size);
+  return true;
+}
+
+void LightState::compute (unsigned int* frame, uint8_t mask) const
+{
+  for (size_t i = 0; i < NUMBER_OF_VALUES; i++)
+  {
+    if (mask & (1 << i))
+    {
+      frame[i] = channel (i);
+    }
+  }
+}
+
+unsigned int LightState::channel (size_t index) const
+{
+  if (!getPower ())
+    return 0;
+  uint8_t brightness = getBrightness ();
+  switch (getColorMode ())
+  {
+  case COLOR_TEMP:
+    {
+      // the colder, the more of the brightness goes to the cold leds
+      unsigned int cold = unsigned (brightness) * (MAX_MIREDS - getColorTemp ()) / (MAX_MIREDS - MIN_MIREDS);
+      if (0 == index) return cold;
+      if (1 == index) return brightness - cold;
+      return 0;
+    }
+  case RGB:
+    return index < 2 ? 0 : scale (record->levels[index], brightness);
+  case FRAME:
+    return scale (record->levels[index], brightness);
+  }
+  return 0;
+}
+
+const char* LightState::getColorModeName () const
+{
+  switch (getColorMode ())
+  {
+  case COLOR_TEMP:
+    return "color_temp";
+  case RGB:
+    return "rgb";
+  case FRAME:
+    return "frame";
+  }
+  return "";
+}
+
+void LightState::printJson (Print& out, const char* effect) const
+{
+  out.print (F ("{\"state\":\""));
+  out.print (getPower () ? "ON" : "OFF");
+  out.print (F ("\",\"brightness\":"));
+  out.print (getBrightness ());
+  out.print (F (",\"color_mode\":\""));
+  out.print (getColorModeName ());
+  out.print ('"');
+  switch (getColorMode ())
+  {
+  case COLOR_TEMP:
+    out.print (F (",\"color_temp\":"));
+    out.print (getColorTemp ());
+    break;
+  case RGB:
+    out.print (F (",\"color\":{\"r\":"));
+    out.print (record->levels[2]);
+    out.print (F (",\"g\":"));
+    out.print (record->levels[3]);
+    out.print (F (",\"b\":"));
+    out.print (record->levels[4]);
+    out.print ('}');
+    break;
+  case FRAME:
+    out.print (F (",\"levels\":["));
+    for (size_t i = 0; i < NUMBER_OF_VALUES; i++)
+    {
+      if (i > 0) out.print (',');
+      out.print (record->levels[i]);
+    }
+    out.print (']');
+    break;
+  }
+  out.print (F (",\"effect\":\""));
+  out.print (effect);
+  out.print (F ("\"}"));
+}
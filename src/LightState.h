@@ -0,0 +1,84 @@
+/*
+ * LightState.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_LIGHTSTATE_H_
+#define SRC_LIGHTSTATE_H_
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "myiot_ConfigStore.h"
+
+/// Typed light state: power, brightness and a color mode with its color temperature, color or frame.
+/* The state is kept in the "ConfigRecord", so it is persistent (call "ConfigStore::save" after a change).
+ * Every change returns the mask of the channels (c, w, r, g, b), that have to be computed again,
+ * "compute" calculates only these channels of the frame.
+ *
+ * "apply" takes a command in the JSON schema of Home Assistant, with relative steps in addition:
+ *   {"state": "ON"|"OFF"|"TOGGLE", "brightness": 0..255, "brightness_step": -255..255,
+ *    "color_temp": mired, "color_temp_step": mired, "color": {"r": .., "g": .., "b": ..}, "transition": seconds}
+ * */
+class LightState
+{
+public:
+  enum ColorMode {COLOR_TEMP = 1, RGB = 2, FRAME = 3};
+  enum {NUMBER_OF_VALUES = 5};
+  enum {CH_COLD = 1, CH_WARM = 2, CH_RED = 4, CH_GREEN = 8, CH_BLUE = 16,
+        WHITE_CHANNELS = CH_COLD | CH_WARM, COLOR_CHANNELS = CH_RED | CH_GREEN | CH_BLUE,
+        ALL_CHANNELS = WHITE_CHANNELS | COLOR_CHANNELS};
+  enum {MIN_MIREDS = 153, MAX_MIREDS = 500};
+  enum {JSON_CAPACITY = JSON_OBJECT_SIZE(8) + JSON_OBJECT_SIZE(3)};
+  enum {MAX_COMMAND_LENGTH = 128};
+
+  LightState ();
+
+  /// use the state in "record", the "ledColors" of older firmware (or after an import of them) are migrated
+  void setup (MyIOT::ConfigRecord& record);
+
+  bool getPower () const { return record->enabled; }
+  uint8_t getBrightness () const { return record->brightness; }
+  ColorMode getColorMode () const { return ColorMode (record->lightMode); }
+  uint16_t getColorTemp () const { return record->colorTemp; }
+
+  /// "color_temp", "rgb" or "frame"
+  const char* getColorModeName () const;
+
+  uint8_t setPower (bool power);
+  uint8_t setBrightness (int brightness);
+  uint8_t setColorTemp (int mireds);
+  uint8_t setColor (uint8_t red, uint8_t green, uint8_t blue);
+
+  /// any mix of the channels, the brightness is the largest value, returns the channels, that changed
+  uint8_t setFrame (const unsigned int* values);
+
+  /// apply a JSON command, "transitionMs" is set, if the command has a transition
+  uint8_t apply (JsonObject& json, uint32_t& transitionMs);
+
+  /// combine the JSON command "message" into the waiting command "pending" (a buffer of "size" bytes)
+  /* The result has the same effect as applying both, e.g. a later absolute value replaces an older one
+   * or step, a step is applied to a waiting value, steps in the same direction are added up. The transition
+   * is the one of the later command. Returns false, if that is not possible, e.g. for a toggle without
+   * a known power state, steps in opposite directions, a change of the color mode back to "color_temp"
+   * or a timed command ("@...").
+   * */
+  static bool merge (char* pending, size_t size, const char* message);
+
+  /// calculate the channels in "mask" of "frame" (c, w, r, g, b), the others are not changed
+  void compute (unsigned int* frame, uint8_t mask) const;
+
+  /// the state as compact JSON, "effect" is the running effect, e.g. "sunrise" or "none"
+  void printJson (Print& out, const char* effect) const;
+
+private:
+  uint8_t setMode (ColorMode mode);
+
+  /// the channels, that the color mode uses
+  uint8_t activeChannels () const;
+  unsigned int channel (size_t index) const;
+  static uint8_t scale (uint8_t level, uint8_t brightness) { return (unsigned (level) * brightness + 127) / 255; }
+
+  MyIOT::ConfigRecord* record;
+};
+
+#endif /* SRC_LIGHTSTATE_H_ */
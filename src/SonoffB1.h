@@ -7,8 +7,8 @@
 
 #ifndef SRC_SONOFFB1_H_
 #define SRC_SONOFFB1_H_
-
-class my92xx;
+#include "LightDrivers.h"
+#include "LightOutput.h"
 
 /* SONOFF B1 has two led driver of type "my9231",
  * each of them controlling three leds.
@@ -21,36 +21,10 @@ class my92xx;
  * ch3 -> green
  * ch4 -> red
  * ch5 -> blue
+ *
+ * DI   -> MTDI -> GPIO 12
+ * DCKI -> MTMS -> GPIO 14
  */
-
-class SonoffB1
-{
-  const static unsigned char MY92XX_DI_PIN = 12;  // MTDI  -> GPIO 12
-  const static unsigned char MY92XX_DCKI_PIN = 14; // MTMS -> GPIO 14
-
-  enum Channel
-  {
-    chCold = 0,
-    chWarm = 1,
-    chRed  = 4,
-    chGreen = 3,
-    chBlue = 5
-  };
-
-
-public:
-  SonoffB1 ();
-  virtual ~SonoffB1 ();
-
-  void setup ();
-  void updateChannel (unsigned char channel, unsigned int value);
-  void controlLeds (const unsigned int* values, size_t length);
-  void controlLeds (const char* message);
-  void controlLeds (unsigned int cold, unsigned int warm, unsigned int red, unsigned int green, unsigned int blue);
-
-private:
-  my92xx* leds = nullptr;
-};
-
+typedef LightOutput<My92xxDriver<12, 14>, ChannelMap<0, 1, 4, 3, 5>> SonoffB1;
 
 #endif /* SRC_SONOFFB1_H_ */
@@ -8,9 +8,10 @@
 #ifndef SRC_SUNRISE_H_
 #define SRC_SUNRISE_H_
 #include <Arduino.h>
-#include <functional>
 #include <limits>
+#include "myiot_function.h"
 #include "myiot_timer_system.h"
+#include "myiot_trace.h"
 
 class Sunrise : public MyIOT::ITimer
 {
@@ -24,7 +25,9 @@ public:
     startTime = millis();
   }
 
-  void setup(std::function<void(uint16_t)> xValueChange)
+  typedef MyIOT::Function<void(uint16_t)> F_ValueChange;
+
+  void setup(const F_ValueChange& xValueChange)
   {
     onValueChange = xValueChange;
   }
@@ -57,6 +60,7 @@ public:
       else
       {
         uint16_t currentValue = getCurrentValue();
+        MYIOT_TRACE(MyIOT::TRACE_SUNRISE_EXPIRE, currentValue);
 
         if (currentValue != lastPublishedValue)
         {
@@ -89,7 +93,7 @@ private:
     return  (float)(millis() - startTime) / (float)(durationInSeconds * 1000);
   }
 
-  std::function<void(uint16_t)> onValueChange;
+  F_ValueChange onValueChange;
   uint32_t durationInSeconds;
   unsigned long startTime;
   uint8_t lastPublishedValue;
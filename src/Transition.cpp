@@ -0,0 +1,50 @@
+/*
+ * Transition.cpp
+ *
+ *  Created on: 19.10.2026
+ */
+
+#include "Transition.h"
+
+Transition::Transition () : fromValues{0}, toValues{0}, durationInMilliseconds(0), startTime(0)
+{
+}
+
+Transition::~Transition ()
+{
+}
+
+void Transition::start (const unsigned int* from, const unsigned int* to, uint32_t aDurationInMilliseconds)
+{
+  for (size_t i = 0; i < NUMBER_OF_VALUES; i++)
+  {
+    fromValues[i] = from[i];
+    toValues[i] = to[i];
+  }
+  durationInMilliseconds = aDurationInMilliseconds;
+  startTime = millis();
+  expire();
+}
+
+void Transition::expire ()
+{
+  if (!isRunning())
+    return;
+
+  unsigned long delta = millis() - startTime;
+  if (delta >= durationInMilliseconds)
+  {
+    reset();
+    if (onValueChange) onValueChange(toValues, NUMBER_OF_VALUES);
+    return;
+  }
+
+  unsigned int values[NUMBER_OF_VALUES];
+  for (size_t i = 0; i < NUMBER_OF_VALUES; i++)
+  {
+    long from = fromValues[i];
+    long to = toValues[i];
+    values[i] = from + (to - from) * long(delta) / long(durationInMilliseconds);
+  }
+  if (onValueChange) onValueChange(values, NUMBER_OF_VALUES);
+}
@@ -0,0 +1,53 @@
+/*
+ * Transition.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_TRANSITION_H_
+#define SRC_TRANSITION_H_
+#include <Arduino.h>
+#include "myiot_function.h"
+#include "myiot_timer_system.h"
+
+/// Linear fade of a frame (c, w, r, g, b) from its current values to a target.
+class Transition : public MyIOT::ITimer
+{
+public:
+  enum {NUMBER_OF_VALUES = 5};
+
+  Transition ();
+  virtual ~Transition ();
+
+  typedef MyIOT::Function<void(const unsigned int* values, size_t length)> F_ValueChange;
+
+  void setup(const F_ValueChange& xValueChange)
+  {
+    onValueChange = xValueChange;
+  }
+
+  void start(const unsigned int* from, const unsigned int* to, uint32_t aDurationInMilliseconds);
+
+  void reset()
+  {
+    durationInMilliseconds = 0;
+  }
+
+  bool isRunning() const
+  {
+    return 0 != durationInMilliseconds;
+  }
+
+  void expire() override;
+
+  void destroy() override {}
+
+private:
+  F_ValueChange onValueChange;
+  unsigned int fromValues[NUMBER_OF_VALUES];
+  unsigned int toValues[NUMBER_OF_VALUES];
+  uint32_t durationInMilliseconds;
+  unsigned long startTime;
+};
+
+#endif /* SRC_TRANSITION_H_ */
@@ -0,0 +1,502 @@
+/*
+ * myiot_ConfigStore.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef MYIOT_CONFIGSTORE_H_
+#define MYIOT_CONFIGSTORE_H_
+
+#include <stddef.h>
+#include <FS.h>
+#include <ArduinoJson.h>
+
+#include "myiot_crc32.h"
+#include "myiot_timer_system.h"
+
+namespace MyIOT
+{
+/// All persistent settings of the device.
+/* The record is stored as it is, so new fields must be appended at the end.
+ * Records written by an older firmware are shorter, the missing fields keep their defaults.
+ * Any other change of the layout needs a new "ConfigStore::VERSION".
+ * */
+struct ConfigRecord
+{
+  enum {MAX_ALARMS = 8, ALARM_LENGTH = 32};
+
+  char deviceName[40];
+  char mqttServer[40];
+  char state[40];
+  char ledColors[40];
+  uint8_t enabled;
+  uint8_t reserved[3];
+  uint32_t streamOffset;
+  char group[40];
+  char timezone[40];                      // POSIX TZ, e.g. "CET-1CEST,M3.5.0,M10.5.0/3", empty is UTC
+  char alarms[MAX_ALARMS][ALARM_LENGTH];  // see "AlarmScheduler"
+  uint8_t lightMode;                      // see "LightState", 0 in records of older firmware
+  uint8_t brightness;
+  uint16_t colorTemp;                     // mired
+  uint8_t levels[5];                      // c,w,r,g,b at full brightness
+  uint8_t reserved2[3];
+};
+
+/// Description of one field of "ConfigRecord", used to import and export JSON.
+/* "BYTES" is an array of "size" numbers 0..255. A field, that is "importOnly", is read
+ * from the files of older firmware, but not exported any more.
+ * The schema is kept in flash (PROGMEM), read a field with "ConfigStore::readField".
+ * */
+struct ConfigField
+{
+  enum Type {STRING, BOOL, UINT32, UINT8, UINT16, BYTES};
+  enum {NAME_LENGTH = 14};
+
+  char name[NAME_LENGTH];
+  uint16_t offset;
+  uint16_t size;
+  Type type;
+  bool importOnly;
+
+  /// the longest JSON text of the field, "name":value
+  /* ArduinoJson escapes a character of a string with at most two characters, e.g. \".
+   * */
+  constexpr size_t jsonLength() const
+  {
+    return 3 + textLength(name) + (STRING == type ? 2 + 2 * (size - 1)
+                                 : BOOL == type ? 5 // false
+                                 : UINT32 == type ? 10
+                                 : UINT8 == type ? 3
+                                 : UINT16 == type ? 5
+                                 : 1 + 4 * size); // [255,...]
+  }
+
+private:
+  static constexpr size_t textLength(const char* text) { return *text ? 1 + textLength(text + 1) : 0; }
+};
+
+/// The fields of "ConfigRecord", in flash, see "ConfigStore::schema".
+/* A template only, so the table can be defined in this header and still be used in constant expressions.
+ * */
+template <typename Record = ConfigRecord>
+struct ConfigSchema
+{
+  enum {NUMBER_OF_FIELDS = 20};
+
+  static constexpr ConfigField fields[NUMBER_OF_FIELDS] PROGMEM =
+  {
+    {"device_name", offsetof(Record, deviceName), sizeof(Record::deviceName), ConfigField::STRING, false},
+    {"mqtt_server", offsetof(Record, mqttServer), sizeof(Record::mqttServer), ConfigField::STRING, false},
+    {"state", offsetof(Record, state), sizeof(Record::state), ConfigField::STRING, false},
+    {"ledColors", offsetof(Record, ledColors), sizeof(Record::ledColors), ConfigField::STRING, true},
+    {"enabled", offsetof(Record, enabled), sizeof(Record::enabled), ConfigField::BOOL, false},
+    {"stream_offset", offsetof(Record, streamOffset), sizeof(Record::streamOffset), ConfigField::UINT32, false},
+    {"group", offsetof(Record, group), sizeof(Record::group), ConfigField::STRING, false},
+    {"timezone", offsetof(Record, timezone), sizeof(Record::timezone), ConfigField::STRING, false},
+    {"alarm0", offsetof(Record, alarms[0]), Record::ALARM_LENGTH, ConfigField::STRING, false},
+    {"alarm1", offsetof(Record, alarms[1]), Record::ALARM_LENGTH, ConfigField::STRING, false},
+    {"alarm2", offsetof(Record, alarms[2]), Record::ALARM_LENGTH, ConfigField::STRING, false},
+    {"alarm3", offsetof(Record, alarms[3]), Record::ALARM_LENGTH, ConfigField::STRING, false},
+    {"alarm4", offsetof(Record, alarms[4]), Record::ALARM_LENGTH, ConfigField::STRING, false},
+    {"alarm5", offsetof(Record, alarms[5]), Record::ALARM_LENGTH, ConfigField::STRING, false},
+    {"alarm6", offsetof(Record, alarms[6]), Record::ALARM_LENGTH, ConfigField::STRING, false},
+    {"alarm7", offsetof(Record, alarms[7]), Record::ALARM_LENGTH, ConfigField::STRING, false},
+    {"light_mode", offsetof(Record, lightMode), sizeof(Record::lightMode), ConfigField::UINT8, false},
+    {"brightness", offsetof(Record, brightness), sizeof(Record::brightness), ConfigField::UINT8, false},
+    {"color_temp", offsetof(Record, colorTemp), sizeof(Record::colorTemp), ConfigField::UINT16, false},
+    {"levels", offsetof(Record, levels), sizeof(Record::levels), ConfigField::BYTES, false},
+  };
+
+  /// the longest JSON object of the fields from "index" on, including those, that are "importOnly"
+  static constexpr size_t jsonLength(size_t index = 0)
+  {
+    return index < NUMBER_OF_FIELDS ? fields[index].jsonLength() + 1 + jsonLength(index + 1) // "," or "}"
+                                    : 1; // "{"
+  }
+};
+
+template <typename Record>
+constexpr ConfigField ConfigSchema<Record>::fields[NUMBER_OF_FIELDS];
+static_assert(0 != ConfigSchema<>::fields[ConfigSchema<>::NUMBER_OF_FIELDS - 1].name[0], "NUMBER_OF_FIELDS");
+
+/// Versioned, CRC-checked store for the "ConfigRecord" in a fixed binary layout.
+/* Reading and writing works on the record directly, without any buffer on the heap.
+ * JSON is only used to import and export the record, e.g. over the web UI,
+ * and to migrate the config files of older firmware.
+ *
+ * "save" writes behind the changes: the record is written, when no further change happened
+ * for "QUIET_PERIOD_MS", and only if its content differs from what is stored already.
+ * "flush" writes immediately. The file is written to a temporary file first and renamed
+ * afterwards, so a power cut while saving leaves either the old or the new config.
+ * */
+class ConfigStore : public MyIOT::ITimer
+{
+  static constexpr const char* CONFIG_FILE = "/config.bin";
+  static constexpr const char* TEMP_FILE = "/config.tmp";
+  static constexpr const char* LEGACY_DEVICE_FILE = "/config.json";
+  static constexpr const char* LEGACY_COLOR_FILE = "/color_config.json";
+
+  static const uint32_t MAGIC = 0x4643594D; // "MYCF"
+  static const uint16_t VERSION = 1;
+  static const unsigned long QUIET_PERIOD_MS = 5000;
+
+  struct Header
+  {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;
+    uint32_t crc;
+  };
+
+public:
+  enum {NUMBER_OF_FIELDS = ConfigSchema<>::NUMBER_OF_FIELDS};
+  /// the exported names are copied from flash into the buffer
+  enum {JSON_CAPACITY = JSON_OBJECT_SIZE(NUMBER_OF_FIELDS) + JSON_ARRAY_SIZE(sizeof(ConfigRecord::levels))
+                        + NUMBER_OF_FIELDS * ConfigField::NAME_LENGTH};
+  /// the longest JSON text of the record, e.g. the export with all strings full of characters, that are escaped
+  enum {MAX_JSON_LENGTH = ConfigSchema<>::jsonLength()};
+
+  ConfigStore(): savedCrc(0), dirty(false), lastChange(0), writes(0)
+  {
+    setDefaults();
+  }
+
+  void setup()
+  {
+    if (!SPIFFS.begin())
+    {
+      error(F("SPIFFS.begin() failed"));
+      return;
+    }
+    recoverTempFile();
+    if (!fsRead() && migrateLegacyFiles())
+    {
+      flush();
+      if (recordCrc() == savedCrc) removeLegacyFiles();
+    }
+  }
+
+  ConfigRecord& get() { return record; }
+  const ConfigRecord& get() const { return record; }
+
+  /// schedule a write, the quiet period starts again with every call
+  void save()
+  {
+    dirty = true;
+    lastChange = millis();
+  }
+
+  /// write pending changes immediately, e.g. before a reset
+  void flush()
+  {
+    fsWrite();
+  }
+
+  unsigned long getWrites() const { return writes; }
+
+  /// the schema in flash, read its fields with "readField"
+  static const ConfigField* schema(size_t& count)
+  {
+    count = ConfigSchema<>::NUMBER_OF_FIELDS;
+    return ConfigSchema<>::fields;
+  }
+
+  /// copy the field "index" of "fields" (in flash)
+  static ConfigField readField(const ConfigField* fields, size_t index)
+  {
+    ConfigField ret;
+    memcpy_P(&ret, &fields[index], sizeof(ret));
+    return ret;
+  }
+
+  /// copy all fields, that are present in "json", into the record
+  /* "ledColors" of older firmware resets "lightMode", so that "LightState::setup" migrates it again,
+   * unless "light_mode" is imported too.
+   * */
+  void importJson(JsonObject& json)
+  {
+    size_t count = 0;
+    const ConfigField* fields = schema(count);
+    for (size_t i = 0; i < count; i++)
+    {
+      const ConfigField field = readField(fields, i);
+      JsonVariant value = json[field.name];
+      if (!value.success()) continue;
+
+      uint8_t* target = reinterpret_cast<uint8_t*>(&record) + field.offset;
+      switch (field.type)
+      {
+      case ConfigField::STRING:
+        setString(reinterpret_cast<char*>(target), value.as<const char*>(), field.size);
+        break;
+      case ConfigField::BOOL:
+        *target = value.is<const char*>() ? (0 == strcmp("1", value.as<const char*>()) || 0 == strcmp("true", value.as<const char*>()))
+                                          : value.as<bool>();
+        break;
+      case ConfigField::UINT32:
+        *reinterpret_cast<uint32_t*>(target) = value.as<unsigned long>();
+        break;
+      case ConfigField::UINT8:
+        *target = value.as<uint8_t>();
+        break;
+      case ConfigField::UINT16:
+        *reinterpret_cast<uint16_t*>(target) = value.as<uint16_t>();
+        break;
+      case ConfigField::BYTES:
+        {
+          JsonArray& array = value.as<JsonArray&>();
+          for (size_t j = 0; j < field.size && j < array.size(); j++)
+          {
+            target[j] = array[j].as<uint8_t>();
+          }
+        }
+        break;
+      }
+      info(F("import"), field.name);
+    }
+    if (json.containsKey("ledColors") && !json.containsKey("light_mode"))
+    {
+      record.lightMode = 0;
+    }
+  }
+
+  /// add all fields of the record to "json", the values are not copied, the names are copied from flash
+  void exportJson(JsonObject& json) const
+  {
+    size_t count = 0;
+    const ConfigField* fields = schema(count);
+    for (size_t i = 0; i < count; i++)
+    {
+      const ConfigField field = readField(fields, i);
+      if (field.importOnly) continue;
+      const __FlashStringHelper* name = FPSTR(fields[i].name);
+      const uint8_t* source = reinterpret_cast<const uint8_t*>(&record) + field.offset;
+      switch (field.type)
+      {
+      case ConfigField::STRING:
+        json[name] = reinterpret_cast<const char*>(source);
+        break;
+      case ConfigField::BOOL:
+        json[name] = 0 != *source;
+        break;
+      case ConfigField::UINT32:
+        json[name] = *reinterpret_cast<const uint32_t*>(source);
+        break;
+      case ConfigField::UINT8:
+        json[name] = *source;
+        break;
+      case ConfigField::UINT16:
+        json[name] = *reinterpret_cast<const uint16_t*>(source);
+        break;
+      case ConfigField::BYTES:
+        {
+          JsonArray& array = json.createNestedArray(name);
+          for (size_t j = 0; j < field.size; j++)
+          {
+            array.add(source[j]);
+          }
+        }
+        break;
+      }
+    }
+  }
+
+  static void setString(char* buffer, const char* value, size_t bufferLength)
+  {
+    strncpy(buffer, value ? value : "", bufferLength);
+    buffer[bufferLength-1] = 0;
+  }
+
+  virtual void expire()
+  {
+    if (dirty && (millis() - lastChange) >= QUIET_PERIOD_MS)
+    {
+      fsWrite();
+    }
+  }
+
+  virtual void destroy(){}
+
+private:
+  void setDefaults()
+  {
+    memset(&record, 0, sizeof(record));
+    setString(record.ledColors, "200,200,0,0,0", sizeof(record.ledColors));
+  }
+
+  uint32_t recordCrc() const
+  {
+    return crc32(&record, sizeof(record));
+  }
+
+  void recoverTempFile()
+  {
+    if (!SPIFFS.exists(TEMP_FILE)) return;
+    if (SPIFFS.exists(CONFIG_FILE))
+    {
+      SPIFFS.remove(TEMP_FILE); // interrupted while writing, the old config is still valid
+    }
+    else
+    {
+      info(F("recover config file"));
+      SPIFFS.rename(TEMP_FILE, CONFIG_FILE); // interrupted between remove and rename
+    }
+  }
+
+  bool fsRead()
+  {
+    if (!SPIFFS.exists(CONFIG_FILE))
+    {
+      info(F("no config file"));
+      return false;
+    }
+
+    File file = SPIFFS.open(CONFIG_FILE, "r");
+    if (!file)
+    {
+      error(F("failed to open config file"));
+      return false;
+    }
+
+    Header header;
+    bool ok = sizeof(header) == file.read(reinterpret_cast<uint8_t*>(&header), sizeof(header))
+        && MAGIC == header.magic
+        && header.size == file.size() - sizeof(header);
+    if (ok && VERSION != header.version)
+    {
+      // another layout, not only appended fields, there is no migration for it (yet)
+      file.close();
+      error(F("unsupported config version"));
+      setDefaults();
+      return false;
+    }
+    if (ok)
+    {
+      // a newer firmware may have appended fields, they are checked but not kept
+      size_t length = header.size < sizeof(record) ? header.size : sizeof(record);
+      ok = length == file.read(reinterpret_cast<uint8_t*>(&record), length);
+      uint32_t crc = crc32(&record, length);
+      for (size_t remaining = header.size - length; ok && remaining > 0; )
+      {
+        uint8_t scratch[16];
+        size_t n = file.read(scratch, min(remaining, sizeof(scratch)));
+        ok = n > 0;
+        crc = crc32(scratch, n, crc);
+        remaining -= n;
+      }
+      ok = ok && crc == header.crc;
+    }
+    file.close();
+
+    if (!ok)
+    {
+      error(F("invalid config file"));
+      setDefaults();
+      return false;
+    }
+
+    info(F("config loaded"));
+    savedCrc = (header.size == sizeof(record)) ? header.crc : 0; // rewrite records of other versions
+    dirty = false;
+    return true;
+  }
+
+  void fsWrite()
+  {
+    dirty = false; // don't retry every tick, the next change will try again
+    uint32_t crc = recordCrc();
+    if (crc == savedCrc) return; // nothing changed, save the flash
+
+    info(F("write config file"));
+    Header header = {MAGIC, VERSION, sizeof(record), crc};
+    File file = SPIFFS.open(TEMP_FILE, "w");
+    if (!file)
+    {
+      error(F("failed to save config file"));
+      return;
+    }
+    size_t written = file.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header));
+    written += file.write(reinterpret_cast<const uint8_t*>(&record), sizeof(record));
+    file.close();
+    if (written != sizeof(header) + sizeof(record))
+    {
+      error(F("failed to write config file"));
+      return;
+    }
+    SPIFFS.remove(CONFIG_FILE); // SPIFFS can not rename onto an existing file
+    if (!SPIFFS.rename(TEMP_FILE, CONFIG_FILE))
+    {
+      error(F("failed to rename config file"));
+      return;
+    }
+    savedCrc = crc;
+    writes++;
+  }
+
+  /// import the JSON files of older firmware, they are removed when the record is written
+  bool migrateLegacyFiles()
+  {
+    bool migrated = migrateLegacyFile(LEGACY_DEVICE_FILE);
+    migrated = migrateLegacyFile(LEGACY_COLOR_FILE) || migrated;
+    return migrated;
+  }
+
+  bool migrateLegacyFile(const char* fileName)
+  {
+    if (!SPIFFS.exists(fileName)) return false;
+    File file = SPIFFS.open(fileName, "r");
+    if (!file) return false;
+
+    char buffer[256] = {0};
+    file.readBytes(buffer, sizeof(buffer) - 1);
+    file.close();
+
+    StaticJsonBuffer<JSON_CAPACITY> jsonBuffer;
+    JsonObject& json = jsonBuffer.parseObject(buffer);
+    if (!json.success())
+    {
+      error(F("failed to parse"), fileName);
+      return false;
+    }
+    info(F("migrate"), fileName);
+    importJson(json);
+    return true;
+  }
+
+  void removeLegacyFiles()
+  {
+    SPIFFS.remove(LEGACY_DEVICE_FILE);
+    SPIFFS.remove(LEGACY_COLOR_FILE);
+  }
+
+  void error(const __FlashStringHelper* msg1, const char* msg2 = nullptr)
+  {
+    i_print(F("error"), msg1, msg2);
+  }
+  void info(const __FlashStringHelper* msg1, const char* msg2 = nullptr)
+  {
+    i_print(F("info"), msg1, msg2);
+  }
+  void i_print(const __FlashStringHelper* type, const __FlashStringHelper* msg1, const char* msg2)
+  {
+    Serial.print(F("ConfigStore "));
+    Serial.print(type);
+    Serial.print(F(": "));
+    Serial.print(msg1);
+    if (msg2)
+    {
+      Serial.print(' ');
+      Serial.print(msg2);
+    }
+    Serial.println();
+  }
+
+  ConfigRecord record;
+  uint32_t savedCrc;
+  bool dirty;
+  unsigned long lastChange;
+  unsigned long writes;
+};
+}
+
+#endif /* MYIOT_CONFIGSTORE_H_ */
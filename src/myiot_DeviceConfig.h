@@ -1,150 +1,147 @@
 #ifndef __DEVICE_CONFIG_H__
 #define __DEVICE_CONFIG_H__
 
-#include <FS.h>
 #include <WiFiManager.h>
-#include <ArduinoJson.h>
 #include <ESP8266WiFi.h>
 
+#include "myiot_ConfigStore.h"
+#include "myiot_function.h"
+#include "myiot_timer_system.h"
+
 namespace MyIOT
 {
-class DeviceConfig
+/// Device name and MQTT server, kept in the "ConfigStore", and the WiFi connection.
+/* "setup" only starts to connect with the stored credentials, it doesn't block.
+ * "expire" watches the connection and calls "onConnected" on the first connect.
+ * Without stored credentials the WiFiManager portal blocks until WiFi is configured or it times out.
+ * With credentials, but no connection after "CONNECT_TIMEOUT_MS" (e.g. the router is down), the portal
+ * runs non-blocking next to the timers, and the stored network is tried again every "CONNECT_TIMEOUT_MS".
+ * */
+class DeviceConfig : public MyIOT::ITimer
 {
-  static constexpr const char *CONFIG_FILE = "/config.json";
-  
+  static const unsigned long CONNECT_TIMEOUT_MS = 30000;
+  static const unsigned long PORTAL_TIMEOUT_S = 180;
+
   public:
-  DeviceConfig():deviceName{0}, mqttServer{0}, state{0} {}
+  typedef MyIOT::Function<void()> F_OnConnected;
 
-  const char* getDeviceName() const{return deviceName;}
-  const char* getMqttServer() const {return mqttServer;}
-  const char* getState() const {return state;}
+  DeviceConfig():store(nullptr), connectStart(0), hasCredentials(false), connected(false),
+    customDeviceName("device", "Device Name", "", sizeof(ConfigRecord::deviceName)),
+    customMqttServer("server", "MQTT Server", "", sizeof(ConfigRecord::mqttServer))
+  {}
 
-  void setDeviceName(const char* name) { secureCopy(deviceName, name, sizeof(deviceName)); }
-  void setMqttServer(const char* server) { secureCopy(mqttServer, server, sizeof(mqttServer)); }
-  void setState(const char* server) { secureCopy(state, server, sizeof(state)); }
-  
-  void setup()
+  const char* getDeviceName() const{return store->get().deviceName;}
+  const char* getMqttServer() const {return store->get().mqttServer;}
+  const char* getState() const {return store->get().state;}
+  const char* getGroup() const {return store->get().group;}
+  const char* getTimezone() const {return store->get().timezone;}
+
+  void setDeviceName(const char* name) { ConfigStore::setString(store->get().deviceName, name, sizeof(store->get().deviceName)); }
+  void setMqttServer(const char* server) { ConfigStore::setString(store->get().mqttServer, server, sizeof(store->get().mqttServer)); }
+  void setState(const char* server) { ConfigStore::setString(store->get().state, server, sizeof(store->get().state)); }
+
+  ConfigStore& getStore() { return *store; }
+
+  void setup(ConfigStore& rstore)
   {
-     fsReadConfig();
+     store = &rstore;
+     WiFi.mode(WIFI_STA);
      WiFi.hostname(this->getDeviceName());
+     hasCredentials = 0 != WiFi.SSID().length();
+     WiFi.begin(); // credentials stored by the SDK
+     connectStart = millis();
 
-     WiFiManager wifiManager;
-     WiFiManagerParameter custom_device_name("device", "Device Name", deviceName, sizeof(deviceName));
-     WiFiManagerParameter custom_mqtt_server("server", "MQTT Server", mqttServer, sizeof(mqttServer));
-     
-     wifiManager.addParameter(&custom_device_name);
-     wifiManager.addParameter(&custom_mqtt_server);
-
+     wifiManager.addParameter(&customDeviceName);
+     wifiManager.addParameter(&customMqttServer);
      wifiManager.setSaveConfigCallback([](){saveConfig = true;});
-     wifiManager.autoConnect();  
-
-     if (saveConfig)
-     {
-       strncpy(deviceName, custom_device_name.getValue(), sizeof(deviceName));
-       strncpy(mqttServer, custom_mqtt_server.getValue(), sizeof(mqttServer));
-       fsSaveConfig();
-     }
+     wifiManager.setConfigPortalTimeout(PORTAL_TIMEOUT_S);
+  }
 
-     WiFi.hostname(this->getDeviceName());
-     IPAddress localIp = WiFi.localIP();
-     Serial.print("localIp: ");
-     Serial.println(localIp.toString());
+  void setOnConnected(const F_OnConnected& xOnConnected)
+  {
+    onConnected = xOnConnected;
   }
 
-  void save(){fsSaveConfig();}
-  
-  private:
+  bool isConnected() const {return connected;}
 
-    void error(const char* msg)
+  virtual void expire()
+  {
+    if (wifiManager.getConfigPortalActive())
     {
-      Serial.print("DeviceConfig error: ");
-      Serial.println(msg);
+      if (wifiManager.process()) saveParameters(); // configured and connected
     }
-  
-    void info(const char* msg)
+    if (connected) return;
+
+    if (WL_CONNECTED == WiFi.status())
     {
-      Serial.print("DeviceConfig info: ");
-      Serial.println(msg);
+      connected = true;
+      if (wifiManager.getConfigPortalActive()) wifiManager.stopConfigPortal();
+      WiFi.hostname(this->getDeviceName());
+      IPAddress localIp = WiFi.localIP();
+      Serial.print(F("localIp: "));
+      Serial.println(localIp.toString());
+      if (onConnected) onConnected();
     }
-    void info(const char* msg1, const char* msg2)
+    else if (!hasCredentials)
     {
-      Serial.print("DeviceConfig info: ");
-      Serial.print(msg1);
-      Serial.print(" ");
-      Serial.println(msg2);
+      startBlockingPortal();
+      hasCredentials = true; // otherwise the portal would start again immediately after its timeout
+      connectStart = millis();
     }
-
-    void secureCopy(char* buffer, const char* value, size_t bufferLength)
+    else if ((millis() - connectStart) > CONNECT_TIMEOUT_MS)
     {
-	strncpy(buffer, value, bufferLength);
-	buffer[bufferLength-1] = 0;
+      if (!wifiManager.getConfigPortalActive()) startPortal();
+      WiFi.begin(); // try the stored network again
+      connectStart = millis();
     }
+  }
 
-    bool readValue(JsonObject& json, const char* valueName, char* buffer, size_t bufferLength)
-    {
-      auto jsonValue = json[valueName];
-      if (!jsonValue.success()) return false;
-      secureCopy(buffer, jsonValue, bufferLength);
-      info(valueName, buffer);
-      return true;
-    }
+  virtual void destroy(){}
 
-    void fsReadConfig()
-    {
-      info("fsReadConfig()");
-      if (SPIFFS.begin())
-      {
-        if (SPIFFS.exists(CONFIG_FILE))
-        {
-          File configFile = SPIFFS.open(CONFIG_FILE, "r");
-          if (configFile)
-          {
-            size_t size = configFile.size();
-            std::unique_ptr<char[]> buffer(new char[size]); // dynamic memory !!!
-            configFile.readBytes(buffer.get(), size);
-            configFile.close();
-            
-            DynamicJsonBuffer jsonBuffer;
-            JsonObject& json = jsonBuffer.parseObject(buffer.get());
-            if (json.success())
-            {
-        	readValue(json, "device_name", deviceName, sizeof(deviceName));
-        	readValue(json, "mqtt_server", mqttServer, sizeof(mqttServer));
-        	readValue(json, "state", state, sizeof(state));
-            }
-            else error("failed to parse config file data");
-          }
-          else error("failed to open config file");
-        }
-        else info("no config file");
-      }
-      else error("SPIFFS.begin() failed");
-    }
+  /// device settings change rarely and are usually followed by a reset, so they are written immediately
+  void save(){store->flush();}
+  
+  private:
+     /// blocks until WiFi is configured or the portal times out, the light keeps its state meanwhile
+     void startBlockingPortal()
+     {
+       setParameters();
+       wifiManager.setConfigPortalBlocking(true);
+       wifiManager.autoConnect();
+       saveParameters();
+     }
 
-    void fsSaveConfig()
-    {
-      info("fsSaveConfig()");
-      DynamicJsonBuffer jsonBuffer;
-      JsonObject& json = jsonBuffer.createObject();
-
-      info("device_name", deviceName);
-      info("mqtt_server", mqttServer);
-                      
-      json["device_name"] = deviceName;
-      json["mqtt_server"] = mqttServer;
-      json["state"] = state;
-      File configFile = SPIFFS.open(CONFIG_FILE, "w");
-      if (configFile)
-      {
-        json.printTo(configFile);
-        configFile.close();
-      } 
-      else error ("failed to save config file");
-    }
+     /// the portal is served by "expire", the timers keep running
+     void startPortal()
+     {
+       setParameters();
+       wifiManager.setConfigPortalBlocking(false);
+       wifiManager.startConfigPortal();
+     }
+
+     void setParameters()
+     {
+       customDeviceName.setValue(getDeviceName(), sizeof(ConfigRecord::deviceName));
+       customMqttServer.setValue(getMqttServer(), sizeof(ConfigRecord::mqttServer));
+     }
 
-     char deviceName[40];
-     char mqttServer[40];
-     char state[40];
+     void saveParameters()
+     {
+       if (!saveConfig) return;
+       setDeviceName(customDeviceName.getValue());
+       setMqttServer(customMqttServer.getValue());
+       save();
+       saveConfig = false;
+     }
+
+     ConfigStore* store;
+     unsigned long connectStart;
+     bool hasCredentials;
+     bool connected;
+     F_OnConnected onConnected;
+     WiFiManager wifiManager;
+     WiFiManagerParameter customDeviceName;
+     WiFiManagerParameter customMqttServer;
      static bool saveConfig;
 };
 
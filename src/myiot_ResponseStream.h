@@ -0,0 +1,133 @@
+/*
+ * myiot_ResponseStream.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef MYIOT_RESPONSESTREAM_H_
+#define MYIOT_RESPONSESTREAM_H_
+
+#include <Print.h>
+#include <ESP8266WebServer.h>
+
+#include "myiot_function.h"
+
+namespace MyIOT
+{
+/// Sends an HTTP response in chunks of a fixed buffer, without building it in a "String".
+/* "render" copies a template from PROGMEM and replaces every "%name%" by calling "F_Value",
+ * which prints the value into the stream, usually with "printEscaped". "%%" is a single '%'.
+ * The lowest free heap while the response is sent, is kept in "getHeapUsed".
+ * */
+class ResponseStream : public Print
+{
+public:
+  enum {BUFFER_SIZE = 256, MAX_NAME_LENGTH = 24};
+
+  typedef MyIOT::Function<void(ResponseStream& out, const char* name)> F_Value;
+
+  ResponseStream(ESP8266WebServer& xserver): server(xserver), length(0), started(false), heapAtStart(ESP.getFreeHeap()), minHeap(heapAtStart)
+  {
+  }
+
+  ~ResponseStream()
+  {
+    end();
+  }
+
+  /// "contentType" may be in flash, e.g. PSTR("text/html")
+  void begin(int code, const char* contentType)
+  {
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send_P(code, contentType, PSTR(""));
+    started = true;
+  }
+
+  /// send the rest and the end of a chunked response
+  void end()
+  {
+    if (!started) return;
+    flush();
+    server.sendContent_P(PSTR(""), 0);
+    started = false;
+  }
+
+  void render(PGM_P tmpl, const F_Value& fValue)
+  {
+    char name[MAX_NAME_LENGTH];
+    size_t nameLength = 0;
+    bool inName = false;
+    for (char c = pgm_read_byte(tmpl); 0 != c; c = pgm_read_byte(++tmpl))
+    {
+      if ('%' == c)
+      {
+        if (inName)
+        {
+          name[nameLength] = 0;
+          if (0 == nameLength) write('%');
+          else if (fValue) fValue(*this, name);
+          nameLength = 0;
+        }
+        inName = !inName;
+      }
+      else if (inName)
+      {
+        if (nameLength < sizeof(name) - 1) name[nameLength++] = c;
+      }
+      else
+      {
+        write(c);
+      }
+    }
+  }
+
+  /// print "value" with the HTML special characters replaced
+  void printEscaped(const char* value)
+  {
+    for (; value && *value; value++)
+    {
+      switch (*value)
+      {
+      case '&': print(F("&amp;")); break;
+      case '<': print(F("&lt;")); break;
+      case '>': print(F("&gt;")); break;
+      case '"': print(F("&quot;")); break;
+      default: write(*value); break;
+      }
+    }
+  }
+
+  virtual size_t write(uint8_t c)
+  {
+    if (length >= sizeof(buffer)) flush();
+    buffer[length++] = c;
+    return 1;
+  }
+
+  void flush()
+  {
+    if (0 == length) return;
+    uint32_t heap = ESP.getFreeHeap();
+    if (heap < minHeap) minHeap = heap;
+    // "sendContent_P" reads with "memcpy_P", which works for RAM as well
+    server.sendContent_P(buffer, length);
+    length = 0;
+  }
+
+  /// heap used while the response was sent, in bytes
+  uint32_t getHeapUsed() const
+  {
+    return heapAtStart > minHeap ? heapAtStart - minHeap : 0;
+  }
+
+private:
+  ESP8266WebServer& server;
+  char buffer[BUFFER_SIZE];
+  size_t length;
+  bool started;
+  uint32_t heapAtStart;
+  uint32_t minHeap;
+};
+}
+
+#endif /* MYIOT_RESPONSESTREAM_H_ */
@@ -0,0 +1,204 @@
+/*
+ * myiot_alarmScheduler.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef MYIOT_ALARMSCHEDULER_H_
+#define MYIOT_ALARMSCHEDULER_H_
+
+#include <Arduino.h>
+
+#include "myiot_clock.h"
+#include "myiot_ConfigStore.h"
+#include "myiot_function.h"
+#include "myiot_timer_system.h"
+
+namespace MyIOT
+{
+/// Weekly recurring alarms, that run a command at a local time, e.g. "12345 06:30 sunrise 1800".
+/* An alarm is "<days> <hh:mm> <command>", days are the digits 1 (Monday) to 7 (Sunday) or "*" for every day.
+ * The alarms are kept as text in the "ConfigRecord", "rebuild" parses them into an index,
+ * sorted by the minute of the week. The scheduler is a one-shot timer, that is scheduled
+ * for the next alarm of the index, at most "MAX_WAKEUP_S" ahead to follow changes of the clock
+ * (e.g. daylight saving time). Until the clock is synchronized, it checks again every "RETRY_S".
+ * An alarm, whose minute passed since the last check (e.g. while the timers were paused), runs late,
+ * if the last check is at most "MAX_CATCH_UP_MINUTES" ago. After a larger jump of the clock only
+ * the alarms of the current minute run, after a jump back the minutes, that passed already, don't run again.
+ * */
+class AlarmScheduler : public MyIOT::ITimer
+{
+public:
+  enum {MAX_ALARMS = ConfigRecord::MAX_ALARMS, ALARM_LENGTH = ConfigRecord::ALARM_LENGTH};
+  enum {MAX_WAKEUP_S = 3600, RETRY_S = 60};
+  enum {MINUTES_PER_DAY = 24 * 60, MINUTES_PER_WEEK = 7 * MINUTES_PER_DAY};
+  enum {MAX_CATCH_UP_MINUTES = 2 * MAX_WAKEUP_S / 60};
+
+  typedef MyIOT::Function<void(const char* command)> F_OnAlarm;
+  typedef char Alarms[MAX_ALARMS][ALARM_LENGTH];
+
+  AlarmScheduler(): tsystem(nullptr), clock(nullptr), alarms(nullptr), count(0), lastMinute(NO_MINUTE), runs(0)
+  {
+  }
+
+  void setup(TimerSystem& xtsystem, const Clock& xclock, const Alarms& xalarms)
+  {
+    tsystem = &xtsystem;
+    clock = &xclock;
+    alarms = &xalarms;
+    tsystem->add(this, TimerSystem::TimeSpec(), "alarm");
+    rebuild();
+  }
+
+  void setOnAlarm(const F_OnAlarm& xOnAlarm) { onAlarm = xOnAlarm; }
+
+  /// parse the alarms again and schedule the next one, e.g. after a change
+  void rebuild()
+  {
+    count = 0;
+    for (uint8_t alarm = 0; alarm < MAX_ALARMS; alarm++)
+    {
+      uint8_t days = 0;
+      uint16_t minuteOfDay = 0;
+      if (!parse((*alarms)[alarm], days, minuteOfDay)) continue;
+      for (uint8_t day = 0; day < 7; day++)
+      {
+        if (days & (1 << day)) insert(day * MINUTES_PER_DAY + minuteOfDay, alarm);
+      }
+    }
+    schedule();
+  }
+
+  /// "text" is "<days> <hh:mm> <command>", "command" points into "text"
+  static bool parse(const char* text, uint8_t& days, uint16_t& minuteOfDay, const char** command = nullptr)
+  {
+    days = 0;
+    for (; *text && ' ' != *text; text++)
+    {
+      if ('*' == *text) days = 0x7F;
+      else if ('1' <= *text && *text <= '7') days |= 1 << (*text - '1');
+      else return false;
+    }
+    unsigned int hour = 0;
+    unsigned int minute = 0;
+    int length = 0;
+    if (0 == days || 2 != sscanf(text, " %u:%u %n", &hour, &minute, &length) || 0 == length
+        || hour > 23 || minute > 59 || 0 == text[length])
+    {
+      return false;
+    }
+    minuteOfDay = hour * 60 + minute;
+    if (command) *command = text + length;
+    return true;
+  }
+
+  /// number of entries in the index, one per alarm and day
+  size_t getCount() const { return count; }
+
+  /// number of alarms, that ran
+  unsigned long getRuns() const { return runs; }
+
+  virtual void expire()
+  {
+    tm local;
+    if (clock->localTime(local))
+    {
+      uint16_t now = minuteOfWeek(local);
+      uint16_t passed = (now + MINUTES_PER_WEEK - lastMinute) % MINUTES_PER_WEEK;
+      if (NO_MINUTE == lastMinute || (passed > MAX_CATCH_UP_MINUTES && passed < MINUTES_PER_WEEK - MAX_CATCH_UP_MINUTES))
+      {
+        passed = 1; // the first check or the clock was set, only the current minute
+      }
+      else if (passed > MAX_CATCH_UP_MINUTES)
+      {
+        passed = 0; // the clock went back, e.g. at the end of daylight saving time
+      }
+      if (passed > 0)
+      {
+        for (size_t i = 0; i < count; i++)
+        {
+          uint16_t since = (now + MINUTES_PER_WEEK - index[i].minute) % MINUTES_PER_WEEK;
+          if (since < passed) run(index[i].alarm);
+        }
+        lastMinute = now;
+      }
+    }
+    schedule();
+  }
+
+  virtual void destroy(){}
+
+private:
+  enum {NO_MINUTE = 0xFFFF};
+
+  struct Entry
+  {
+    uint16_t minute; // of the week, 0 is Monday 00:00
+    uint8_t alarm;
+  };
+
+  static uint16_t minuteOfWeek(const tm& local)
+  {
+    return ((local.tm_wday + 6) % 7) * MINUTES_PER_DAY + local.tm_hour * 60 + local.tm_min;
+  }
+
+  /// insertion sort, the index is small and changes rarely
+  void insert(uint16_t minute, uint8_t alarm)
+  {
+    size_t pos = count++;
+    for (; pos > 0 && index[pos - 1].minute > minute; pos--)
+    {
+      index[pos] = index[pos - 1];
+    }
+    index[pos].minute = minute;
+    index[pos].alarm = alarm;
+  }
+
+  void schedule()
+  {
+    tm local;
+    if (!clock->localTime(local))
+    {
+      tsystem->schedule(*this, TimerSystem::TimeSpec(RETRY_S, 0));
+      return;
+    }
+    if (0 == count) return; // "rebuild" schedules again
+
+    uint16_t now = minuteOfWeek(local);
+    uint32_t next = index[0].minute + MINUTES_PER_WEEK;
+    for (size_t i = 0; i < count; i++)
+    {
+      if (index[i].minute > now)
+      {
+        next = index[i].minute;
+        break;
+      }
+    }
+    uint32_t seconds = (next - now) * 60 - local.tm_sec;
+    tsystem->schedule(*this, TimerSystem::TimeSpec(seconds < MAX_WAKEUP_S ? seconds : uint32_t(MAX_WAKEUP_S), 0));
+  }
+
+  void run(uint8_t alarm)
+  {
+    uint8_t days = 0;
+    uint16_t minuteOfDay = 0;
+    const char* command = nullptr;
+    if (!parse((*alarms)[alarm], days, minuteOfDay, &command)) return;
+    Serial.print(F("alarm: "));
+    Serial.println(command);
+    runs++;
+    if (onAlarm) onAlarm(command);
+  }
+
+  TimerSystem* tsystem;
+  const Clock* clock;
+  const Alarms* alarms;
+  Entry index[MAX_ALARMS * 7];
+  size_t count;
+  uint16_t lastMinute; // of the week, at the last check
+  unsigned long runs;
+  F_OnAlarm onAlarm;
+};
+}
+
+#endif /* MYIOT_ALARMSCHEDULER_H_ */
@@ -0,0 +1,89 @@
+/*
+ * myiot_clock.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef MYIOT_CLOCK_H_
+#define MYIOT_CLOCK_H_
+
+#include <Arduino.h>
+#include <time.h>
+#include <sys/time.h>
+
+namespace MyIOT
+{
+/// Wall clock in UTC, synchronized by SNTP, the shared time base of all devices.
+/* Commands can carry a start time of this clock, so that several devices
+ * start at the same moment, independent of their message latency.
+ * If no SNTP server is reachable, "setTime" sets the clock from another source, e.g. MQTT,
+ * as long as it wasn't synchronized by SNTP.
+ * The time zone is used for local times only, e.g. by "AlarmScheduler".
+ * */
+class Clock
+{
+public:
+  /// times before 2020 mean "not synchronized yet"
+  static const time_t VALID_AFTER = 1577836800;
+
+  /// "timezone" is a POSIX TZ string, nullptr or empty is UTC
+  void setup(const char* timezone, const char* server = "pool.ntp.org")
+  {
+    configTime(0, 0, server);
+    setTimezone(timezone); // after "configTime", it sets TZ too
+  }
+
+  void setTimezone(const char* timezone)
+  {
+    setenv("TZ", (timezone && timezone[0]) ? timezone : "UTC0", 1);
+    tzset();
+  }
+
+  Clock(): setManually(false)
+  {
+  }
+
+  /// set the clock to "ms" since 1970, unless SNTP has synchronized it already
+  /* Later calls correct the clock again, e.g. its drift.
+   * */
+  bool setTime(uint64_t ms)
+  {
+    if (isSynchronized() && !setManually) return false;
+    timeval tv;
+    tv.tv_sec = ms / 1000;
+    tv.tv_usec = (ms % 1000) * 1000;
+    if (0 != settimeofday(&tv, nullptr)) return false;
+    setManually = true;
+    return true;
+  }
+
+  /// the local time, false while not synchronized
+  bool localTime(tm& local) const
+  {
+    if (!isSynchronized()) return false;
+    time_t now = time(nullptr);
+    localtime_r(&now, &local);
+    return true;
+  }
+
+  bool isSynchronized() const
+  {
+    return time(nullptr) > VALID_AFTER;
+  }
+
+  /// milliseconds since 1970, 0 while not synchronized
+  uint64_t now_ms() const
+  {
+    if (!isSynchronized()) return 0;
+    timeval tv;
+    gettimeofday(&tv, nullptr);
+    return uint64_t(tv.tv_sec) * 1000 + tv.tv_usec / 1000;
+  }
+
+private:
+  /// the time is set by "setTime", not (yet) by SNTP
+  bool setManually;
+};
+}
+
+#endif /* MYIOT_CLOCK_H_ */
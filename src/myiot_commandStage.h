@@ -0,0 +1,159 @@
+/*
+ * myiot_commandStage.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef MYIOT_COMMANDSTAGE_H_
+#define MYIOT_COMMANDSTAGE_H_
+
+#include <Arduino.h>
+
+#include "myiot_function.h"
+#include "myiot_timer_system.h"
+
+namespace MyIOT
+{
+/// Decouples inbound commands (e.g. MQTT messages) from applying them.
+/* "submit" only copies the message into a FIFO queue, that is shared by all targets, because they act
+ * on the same thing (e.g. "set" and "control" of a light). Every "expire" (one per frame) applies at most
+ * the oldest waiting command, so the order over all targets is kept. A token bucket per target limits,
+ * how often its commands are applied, the oldest command waits for its token and holds back the others.
+ *
+ * A new message may only be combined with the newest waiting one, if that is of the same target
+ * and its "F_Merge" agrees (counted as coalesced), e.g. an absolute value replaces an older one.
+ * Otherwise it is queued, so no input is lost. Messages, that don't fit into an entry, or arrive while
+ * the queue is full, are dropped.
+ * */
+class CommandStage : public MyIOT::ITimer
+{
+public:
+  enum {MAX_TARGETS = 4, MAX_QUEUED = 6, MESSAGE_LENGTH = 128};
+
+  typedef MyIOT::Function<void(const char* message)> F_Execute;
+
+  /// combine "message" into "pending" (a buffer of "size" bytes), false if that would change the result
+  typedef MyIOT::Function<bool(char* pending, size_t size, const char* message)> F_Merge;
+
+  CommandStage(): queued(0), submitted(0), coalesced(0), dropped(0), applied(0)
+  {
+  }
+
+  /// "target" applies at most "ratePerSecond" commands per second, after a burst of "burst" commands
+  /* Without "merge" every message is queued.
+   * */
+  bool setup(size_t target, const F_Execute& execute, uint16_t ratePerSecond, uint8_t burst,
+             const F_Merge& merge = F_Merge())
+  {
+    if (target >= MAX_TARGETS) return false;
+    Slot& slot = slots[target];
+    slot.execute = execute;
+    slot.merge = merge;
+    slot.rate = ratePerSecond;
+    slot.capacity = burst * 1000ul;
+    slot.tokens = slot.capacity;
+    slot.lastRefill = millis();
+    return true;
+  }
+
+  bool submit(size_t target, const char* message)
+  {
+    if (target >= MAX_TARGETS) return false;
+    submitted++;
+    size_t length = strlen(message);
+    if (length >= MESSAGE_LENGTH)
+    {
+      dropped++;
+      return false;
+    }
+    Slot& slot = slots[target];
+    Entry* newest = queued > 0 ? &queue[queued - 1] : nullptr;
+    if (newest && newest->target == target && slot.merge && slot.merge(newest->message, MESSAGE_LENGTH, message))
+    {
+      coalesced++;
+      return true;
+    }
+    if (queued >= MAX_QUEUED)
+    {
+      dropped++;
+      return false;
+    }
+    Entry& entry = queue[queued++];
+    entry.target = target;
+    memcpy(entry.message, message, length + 1);
+    return true;
+  }
+
+  /// room for a new message, besides one entry in reserve for a message, that has to be taken anyway
+  /* E.g. "Mqtt::setReady", that reads a message for the keepalive, even while the stage isn't ready.
+   * */
+  bool canAccept() const { return queued + 1 < MAX_QUEUED; }
+
+  unsigned long getSubmitted() const { return submitted; }
+  unsigned long getCoalesced() const { return coalesced; }
+  unsigned long getDropped() const { return dropped; }
+  unsigned long getApplied() const { return applied; }
+
+  virtual void expire()
+  {
+    if (0 == queued) return;
+    Slot& slot = slots[queue[0].target];
+    slot.refill(millis());
+    if (slot.tokens < 1000) return;
+
+    slot.tokens -= 1000;
+    applied++;
+    char message[MESSAGE_LENGTH];
+    memcpy(message, queue[0].message, MESSAGE_LENGTH);
+    remove(); // before "execute", which may submit again
+    if (slot.execute) slot.execute(message);
+  }
+
+  virtual void destroy(){}
+
+private:
+  struct Entry
+  {
+    uint8_t target;
+    char message[MESSAGE_LENGTH];
+  };
+
+  struct Slot
+  {
+    Slot(): rate(0), tokens(0), capacity(0), lastRefill(0) {}
+
+    /// tokens are counted in 1/1000
+    void refill(unsigned long now)
+    {
+      unsigned long elapsed = now - lastRefill;
+      if (0 != rate && elapsed > capacity / rate) tokens = capacity;
+      else tokens += elapsed * rate;
+      if (tokens > capacity) tokens = capacity;
+      lastRefill = now;
+    }
+
+    uint16_t rate;
+    unsigned long tokens;
+    unsigned long capacity;
+    unsigned long lastRefill;
+    F_Execute execute;
+    F_Merge merge;
+  } slots[MAX_TARGETS];
+
+  /// the oldest entry
+  void remove()
+  {
+    memmove(&queue[0], &queue[1], (queued - 1) * sizeof(Entry));
+    queued--;
+  }
+
+  Entry queue[MAX_QUEUED];
+  size_t queued;
+  unsigned long submitted;
+  unsigned long coalesced;
+  unsigned long dropped;
+  unsigned long applied;
+};
+}
+
+#endif /* MYIOT_COMMANDSTAGE_H_ */
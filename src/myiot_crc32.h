@@ -0,0 +1,34 @@
+/*
+ * myiot_crc32.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef MYIOT_CRC32_H_
+#define MYIOT_CRC32_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace MyIOT
+{
+/// CRC-32 (IEEE 802.3), bitwise, i.e. without a lookup table in RAM.
+/* To checksum several blocks, pass the result of the previous call as "crc".
+ * */
+inline uint32_t crc32(const void* data, size_t length, uint32_t crc = 0)
+{
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  crc = ~crc;
+  while (length--)
+  {
+    crc ^= *bytes++;
+    for (int bit = 0; bit < 8; bit++)
+    {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+}
+
+#endif /* MYIOT_CRC32_H_ */
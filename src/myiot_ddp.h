@@ -0,0 +1,189 @@
+/*
+ * myiot_ddp.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef MYIOT_DDP_H_
+#define MYIOT_DDP_H_
+
+#include <WiFiUdp.h>
+
+#include "myiot_function.h"
+#include "myiot_timer_system.h"
+
+namespace MyIOT
+{
+/// Receiver for the "Distributed Display Protocol" (DDP), a realtime lighting protocol over UDP.
+/* Each packet carries a slice of a global channel space (one byte per channel).
+ * The receiver maps "NUMBER_OF_CHANNELS" channels, starting at a configurable channel offset,
+ * onto a local frame and calls "onFrame", whenever a packet with the push flag completes a frame.
+ * The stream is active from the first frame on. If no frame follows for "timeout" milliseconds,
+ * "onTimeout" is called once, so the owner can restore its regular state.
+ * Packets, that are not valid, and packets, that got lost (a gap in the sequence numbers), are counted apart.
+ * */
+class DdpReceiver : public MyIOT::ITimer
+{
+public:
+  enum {NUMBER_OF_CHANNELS = 5};
+  enum {DEFAULT_PORT = 4048};
+
+  typedef MyIOT::Function<void(const unsigned int* values, size_t length)> F_OnFrame;
+  typedef MyIOT::Function<void()> F_OnTimeout;
+
+  DdpReceiver(): channelOffset(0), timeout(2500), lastFrame(0), active(false), pending(false),
+    lastSequence(0), received(0), invalid(0), lost(0), values{0}
+  {
+  }
+
+  void setup(uint16_t port = DEFAULT_PORT)
+  {
+    udp.begin(port);
+  }
+
+  void setOnFrame(const F_OnFrame& xOnFrame) { onFrame = xOnFrame; }
+  void setOnTimeout(const F_OnTimeout& xOnTimeout) { onTimeout = xOnTimeout; }
+
+  void setChannelOffset(uint32_t offset) { channelOffset = offset; }
+  uint32_t getChannelOffset() const { return channelOffset; }
+
+  void setTimeout(unsigned long milliseconds) { timeout = milliseconds; }
+
+  /// a frame of the stream is shown
+  bool isActive() const { return active; }
+  unsigned long getReceived() const { return received; }
+  unsigned long getInvalid() const { return invalid; }
+  unsigned long getLost() const { return lost; }
+
+  virtual void expire()
+  {
+    // drain everything that arrived since the last tick, only the last frame matters
+    for (int size = udp.parsePacket(); size > 0; size = udp.parsePacket())
+    {
+      if (readPacket(size))
+      {
+        received++;
+      }
+      else
+      {
+        invalid++;
+      }
+      udp.flush();
+    }
+
+    if (active && (millis() - lastFrame) > timeout)
+    {
+      active = false;
+      pending = false;
+      if (onTimeout) onTimeout();
+    }
+  }
+
+  virtual void destroy(){}
+
+private:
+  enum
+  {
+    HEADER_LENGTH = 10,
+    TIMECODE_LENGTH = 4,
+
+    FLAG_VERSION_MASK = 0xC0,
+    FLAG_VERSION_1 = 0x40,
+    FLAG_TIMECODE = 0x10,
+    FLAG_QUERY = 0x02,
+    FLAG_PUSH = 0x01,
+
+    ID_DISPLAY = 1,
+    ID_ALL = 255
+  };
+
+  bool readPacket(int size)
+  {
+    uint8_t header[HEADER_LENGTH + TIMECODE_LENGTH];
+    if (size < HEADER_LENGTH) return false;
+    if (HEADER_LENGTH != udp.read(header, HEADER_LENGTH)) return false;
+
+    uint8_t flags = header[0];
+    if (FLAG_VERSION_1 != (flags & FLAG_VERSION_MASK)) return false;
+    if (flags & FLAG_QUERY) return true; // no replies, but it is a valid packet
+
+    uint8_t id = header[3];
+    if (ID_DISPLAY != id && ID_ALL != id) return false;
+
+    size -= HEADER_LENGTH;
+    if (flags & FLAG_TIMECODE)
+    {
+      if (size < TIMECODE_LENGTH) return false;
+      udp.read(header + HEADER_LENGTH, TIMECODE_LENGTH); // timecode is ignored
+      size -= TIMECODE_LENGTH;
+    }
+
+    uint32_t dataOffset = (uint32_t(header[4]) << 24) | (uint32_t(header[5]) << 16) | (uint32_t(header[6]) << 8) | header[7];
+    uint16_t dataLength = (uint16_t(header[8]) << 8) | header[9];
+    if (int(dataLength) > size) return false;
+
+    uint8_t sequence = header[1] & 0x0F; // 1..15, 0 means "not used"
+    if (0 != sequence && 0 != lastSequence && sequence != lastSequence % 15 + 1)
+    {
+      lost++; // a packet of the stream got lost, this one is still fine
+    }
+    lastSequence = sequence;
+
+    // copy the overlapping part of [dataOffset, dataOffset + dataLength) into our channels
+    uint32_t first = max(dataOffset, channelOffset);
+    uint32_t last = min(dataOffset + dataLength, channelOffset + NUMBER_OF_CHANNELS);
+    if (first < last)
+    {
+      skip(first - dataOffset);
+      uint8_t data[NUMBER_OF_CHANNELS];
+      size_t length = last - first;
+      if (int(length) != udp.read(data, length)) return false;
+      for (size_t i = 0; i < length; i++)
+      {
+        values[first - channelOffset + i] = data[i];
+      }
+      pending = true;
+    }
+
+    if ((flags & FLAG_PUSH) && pending)
+    {
+      pending = false;
+      lastFrame = millis();
+      active = true;
+      if (onFrame) onFrame(values, NUMBER_OF_CHANNELS);
+    }
+    return true;
+  }
+
+  void skip(size_t length)
+  {
+    uint8_t scratch[32];
+    while (length > 0)
+    {
+      int n = udp.read(scratch, min(length, sizeof(scratch)));
+      if (n <= 0) return;
+      length -= n;
+    }
+  }
+
+  WiFiUDP udp;
+
+  uint32_t channelOffset;
+  unsigned long timeout;
+  unsigned long lastFrame;
+  bool active;
+  bool pending;
+  uint8_t lastSequence;
+
+  unsigned long received;
+  unsigned long invalid;
+  unsigned long lost;
+
+  unsigned int values[NUMBER_OF_CHANNELS];
+
+  F_OnFrame onFrame;
+  F_OnTimeout onTimeout;
+};
+}
+
+#endif /* MYIOT_DDP_H_ */
@@ -0,0 +1,137 @@
+/*
+ * myiot_function.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef MYIOT_FUNCTION_H_
+#define MYIOT_FUNCTION_H_
+
+#include <stddef.h>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace MyIOT
+{
+template <typename Signature, size_t Capacity = 2 * sizeof(void*)>
+class Function;
+
+/// Callable wrapper like "std::function", but the callable is always stored inside the object.
+/* It never allocates: a lambda, whose captures don't fit into "Capacity" bytes,
+ * fails to compile. Calls go through one function pointer, no virtual call.
+ * */
+template <typename R, typename... Args, size_t Capacity>
+class Function<R(Args...), Capacity>
+{
+  template <typename F>
+  using EnableIfCallable = typename std::enable_if<
+      !std::is_same<typename std::decay<F>::type, Function>::value
+      && std::is_convertible<decltype(std::declval<typename std::decay<F>::type&>()(std::declval<Args>()...)), R>::value
+      >::type;
+
+public:
+  Function(): ops(nullptr)
+  {
+  }
+
+  Function(std::nullptr_t): ops(nullptr)
+  {
+  }
+
+  template <typename F, typename = EnableIfCallable<F>>
+  Function(F&& f): ops(nullptr)
+  {
+    typedef typename std::decay<F>::type Callable;
+    static_assert(sizeof(Callable) <= Capacity, "MyIOT::Function: the captures are too large, increase the capacity");
+    static_assert(alignof(Callable) <= alignof(Storage), "MyIOT::Function: the callable needs a larger alignment");
+    new (&storage) Callable(std::forward<F>(f));
+    ops = &Ops<Callable>::table;
+  }
+
+  Function(const Function& src): ops(src.ops)
+  {
+    if (ops) ops->copy(&storage, &src.storage);
+  }
+
+  Function& operator=(const Function& src)
+  {
+    if (this != &src)
+    {
+      reset();
+      ops = src.ops;
+      if (ops) ops->copy(&storage, &src.storage);
+    }
+    return *this;
+  }
+
+  Function& operator=(std::nullptr_t)
+  {
+    reset();
+    return *this;
+  }
+
+  ~Function()
+  {
+    reset();
+  }
+
+  explicit operator bool() const
+  {
+    return nullptr != ops;
+  }
+
+  R operator()(Args... args) const
+  {
+    return ops->invoke(&storage, std::forward<Args>(args)...);
+  }
+
+private:
+  typedef typename std::aligned_storage<Capacity, alignof(void*)>::type Storage;
+
+  struct OpsTable
+  {
+    R (*invoke)(void* callable, Args&&... args);
+    void (*copy)(void* target, const void* source);
+    void (*destroy)(void* callable);
+  };
+
+  template <typename Callable>
+  struct Ops
+  {
+    static R invoke(void* callable, Args&&... args)
+    {
+      return (*static_cast<Callable*>(callable))(std::forward<Args>(args)...);
+    }
+    static void copy(void* target, const void* source)
+    {
+      new (target) Callable(*static_cast<const Callable*>(source));
+    }
+    static void destroy(void* callable)
+    {
+      static_cast<Callable*>(callable)->~Callable();
+    }
+    static const OpsTable table;
+  };
+
+  void reset()
+  {
+    if (ops) ops->destroy(&storage);
+    ops = nullptr;
+  }
+
+  mutable Storage storage;
+  const OpsTable* ops;
+};
+
+template <typename R, typename... Args, size_t Capacity>
+template <typename Callable>
+const typename Function<R(Args...), Capacity>::OpsTable Function<R(Args...), Capacity>::Ops<Callable>::table =
+{
+  &Function<R(Args...), Capacity>::Ops<Callable>::invoke,
+  &Function<R(Args...), Capacity>::Ops<Callable>::copy,
+  &Function<R(Args...), Capacity>::Ops<Callable>::destroy
+};
+}
+
+#endif /* MYIOT_FUNCTION_H_ */
@@ -0,0 +1,216 @@
+/*
+ * myiot_httpUpdate.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef MYIOT_HTTPUPDATE_H_
+#define MYIOT_HTTPUPDATE_H_
+
+#include <Arduino.h>
+#include <ESP8266HTTPClient.h>
+#include <Updater.h>
+#include <WiFiClient.h>
+
+#include "myiot_function.h"
+#include "myiot_timer_system.h"
+
+namespace MyIOT
+{
+/// Pulls a firmware image over HTTP and restarts with it.
+/* The image may be gzip compressed (needs ESP8266 core 2.7 or newer, eboot unpacks it),
+ * it is verified with the MD5 of the file as it is downloaded.
+ * "start" only takes the command, the request is sent by the next "expire", so not e.g. within the
+ * callback of an MQTT message. While the download runs, all other timers of the "TimerSystem" are paused,
+ * except the one given to "setup", e.g. MQTT to keep its connection alive. Every "expire" writes one chunk
+ * to flash. Progress and throughput are reported once per second.
+ * */
+class HttpUpdate : public MyIOT::ITimer
+{
+public:
+  enum {CHUNK_SIZE = 1460, TIMEOUT_MS = 10000, REPORT_INTERVAL_MS = 1000};
+  enum {MAX_URL_LENGTH = 128, MD5_LENGTH = 32};
+
+  typedef MyIOT::Function<void(const char* status)> F_OnProgress;
+  typedef MyIOT::Function<void()> F_OnRestart;
+
+  HttpUpdate(): tsystem(nullptr), keepRunning(nullptr), requested(false), buffer(nullptr), size(0), written(0),
+      startTime(0), lastData(0), lastReport(0)
+  {
+    url[0] = 0;
+    md5[0] = 0;
+  }
+
+  /// "xkeepRunning" is not paused during the download
+  void setup(TimerSystem& xtsystem, const ITimer* xkeepRunning = nullptr)
+  {
+    tsystem = &xtsystem;
+    keepRunning = xkeepRunning;
+  }
+
+  void setOnProgress(const F_OnProgress& xOnProgress) { onProgress = xOnProgress; }
+
+  /// called before the restart with the new image, e.g. to save pending settings
+  void setOnRestart(const F_OnRestart& xOnRestart) { onRestart = xOnRestart; }
+
+  bool isRunning() const { return nullptr != buffer; }
+
+  /// "command" is "<url> <md5>", "md5" are the 32 hex digits of the (compressed) image
+  /* The download starts with the next "expire".
+   * */
+  bool start(const char* command)
+  {
+    if (isRunning() || requested) return false;
+
+    if (2 != sscanf(command, "%127s %32s", url, md5) || MD5_LENGTH != strlen(md5))
+    {
+      return fail("command", 0);
+    }
+    requested = true;
+    return true;
+  }
+
+  virtual void expire()
+  {
+    if (requested)
+    {
+      requested = false;
+      begin();
+      return;
+    }
+    if (!isRunning()) return;
+
+    unsigned long now = millis();
+    WiFiClient* stream = http.getStreamPtr();
+    size_t available = stream->available();
+    if (available > 0)
+    {
+      size_t length = stream->read(buffer, available < CHUNK_SIZE ? available : size_t(CHUNK_SIZE));
+      if (Update.write(buffer, length) != length)
+      {
+        Update.end(); // not finished, so nothing is activated
+        fail("write", Update.getError());
+        return;
+      }
+      written += length;
+      lastData = now;
+    }
+    else if (now - lastData > TIMEOUT_MS || !stream->connected())
+    {
+      Update.end();
+      fail("receive", written);
+      return;
+    }
+
+    if (written >= size)
+    {
+      finish();
+    }
+    else if (now - lastReport >= REPORT_INTERVAL_MS)
+    {
+      lastReport = now;
+      report("progress");
+    }
+  }
+
+  virtual void destroy(){}
+
+private:
+  /// send the request and prepare the flash, then "expire" downloads the image
+  bool begin()
+  {
+    if (!http.begin(client, url))
+    {
+      return fail("url", 0);
+    }
+    int code = http.GET();
+    if (HTTP_CODE_OK != code)
+    {
+      return fail("http", code);
+    }
+    int length = http.getSize();
+    if (length <= 0)
+    {
+      return fail("size", length);
+    }
+    if (!Update.begin(length) || !Update.setMD5(md5))
+    {
+      return fail("begin", Update.getError());
+    }
+
+    buffer = new uint8_t[CHUNK_SIZE];
+    size = length;
+    written = 0;
+    startTime = lastData = lastReport = millis();
+    if (tsystem) tsystem->set_exclusive(this, keepRunning);
+    report("start");
+    return true;
+  }
+
+  /// kB/s since start
+  unsigned long throughput() const
+  {
+    unsigned long elapsed = millis() - startTime;
+    return elapsed ? written / elapsed : 0; // bytes/ms == kB/s
+  }
+
+  void report(const char* step)
+  {
+    char status[64];
+    snprintf_P(status, sizeof(status), PSTR("%s %u%% %lu/%lu %lu kB/s"),
+             step, size ? unsigned(written * 100 / size) : 0, written, size, throughput());
+    Serial.println(status);
+    if (onProgress) onProgress(status);
+  }
+
+  bool fail(const char* step, int code)
+  {
+    char status[48];
+    snprintf_P(status, sizeof(status), PSTR("error %s %d"), step, code);
+    Serial.println(status);
+    stop();
+    if (onProgress) onProgress(status);
+    return false;
+  }
+
+  void finish()
+  {
+    if (!Update.end()) // checks size and MD5
+    {
+      fail("verify", Update.getError());
+      return;
+    }
+    report("done");
+    stop();
+    if (onRestart) onRestart();
+    delay(500); // let the report leave the device
+    ESP.restart();
+  }
+
+  void stop()
+  {
+    http.end();
+    delete[] buffer;
+    buffer = nullptr;
+    if (tsystem) tsystem->set_exclusive(nullptr);
+  }
+
+  TimerSystem* tsystem;
+  const ITimer* keepRunning;
+  bool requested;
+  char url[MAX_URL_LENGTH];
+  char md5[MD5_LENGTH + 1];
+  WiFiClient client;
+  HTTPClient http;
+  uint8_t* buffer;
+  unsigned long size;
+  unsigned long written;
+  unsigned long startTime;
+  unsigned long lastData;
+  unsigned long lastReport;
+  F_OnProgress onProgress;
+  F_OnRestart onRestart;
+};
+}
+
+#endif /* MYIOT_HTTPUPDATE_H_ */
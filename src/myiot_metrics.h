@@ -0,0 +1,148 @@
+/*
+ * myiot_metrics.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef MYIOT_METRICS_H_
+#define MYIOT_METRICS_H_
+
+#include <Print.h>
+
+#include "myiot_timer_system.h"
+
+namespace MyIOT
+{
+/// The heap values at one moment, e.g. to print the same metrics twice.
+struct HeapSnapshot
+{
+  HeapSnapshot(): free(ESP.getFreeHeap()), maxBlock(ESP.getMaxFreeBlockSize()), fragmentation(ESP.getHeapFragmentation())
+  {
+  }
+  uint32_t free;
+  uint32_t maxBlock;
+  uint8_t fragmentation;
+};
+
+/// Writes metrics in the Prometheus text format directly into a "Print", e.g. a "ResponseStream".
+/* Nothing is buffered or allocated, so a scrape costs only the time to send it.
+ * All names get the prefix "myiot_". Integers are printed exactly, also 64 bit ones ("Print" prints
+ * "ovf" for doubles above 2^32), "double" is for fractional values.
+ * */
+class MetricsWriter
+{
+public:
+  MetricsWriter(Print& xout): out(xout)
+  {
+  }
+
+  template <typename T>
+  void gauge(const __FlashStringHelper* name, T value)
+  {
+    type(name, F("gauge"));
+    sample(name, value);
+  }
+
+  template <typename T>
+  void counter(const __FlashStringHelper* name, T value)
+  {
+    type(name, F("counter"));
+    sample(name, value);
+  }
+
+  void type(const __FlashStringHelper* name, const __FlashStringHelper* metricType)
+  {
+    out.print(F("# TYPE myiot_"));
+    out.print(name);
+    out.print(' ');
+    out.println(metricType);
+  }
+
+  template <typename T>
+  void sample(const __FlashStringHelper* name, T value, const __FlashStringHelper* labelName = nullptr,
+              const char* labelValue = nullptr)
+  {
+    out.print(F("myiot_"));
+    out.print(name);
+    if (labelName)
+    {
+      out.print('{');
+      out.print(labelName);
+      out.print(F("=\""));
+      out.print(labelValue);
+      out.print(F("\"}"));
+    }
+    out.print(' ');
+    printValue(value);
+    out.println();
+  }
+
+  /// loop and per timer statistics of "tsystem"
+  /* "timer_heap_low_bytes" is the lowest free heap after the timer expired, i.e. the low-water mark of
+   * what the subsystem keeps allocated, "heap_idle_bytes" is the free heap after the last loop iteration.
+   * */
+  void timerSystem(const TimerSystem& tsystem)
+  {
+    counter(F("loop_iterations_total"), tsystem.get_iterations());
+    gauge(F("loop_max_us"), tsystem.get_max_loop_us());
+    gauge(F("heap_idle_bytes"), tsystem.get_idle_heap());
+    gauge(F("heap_low_bytes"), tsystem.get_min_heap());
+
+    type(F("timer_calls_total"), F("counter"));
+    tsystem.for_each_timer([this](const char* name, const TimerSystem::Stats& stats)
+                           { this->sample(F("timer_calls_total"), stats.calls, F("timer"), name); });
+    type(F("timer_runtime_us_total"), F("counter"));
+    tsystem.for_each_timer([this](const char* name, const TimerSystem::Stats& stats)
+                           { this->sample(F("timer_runtime_us_total"), stats.total_us, F("timer"), name); });
+    type(F("timer_max_us"), F("gauge"));
+    tsystem.for_each_timer([this](const char* name, const TimerSystem::Stats& stats)
+                           { this->sample(F("timer_max_us"), stats.max_us, F("timer"), name); });
+    type(F("timer_heap_low_bytes"), F("gauge"));
+    tsystem.for_each_timer([this](const char* name, const TimerSystem::Stats& stats)
+                           { if (stats.calls) this->sample(F("timer_heap_low_bytes"), stats.min_heap, F("timer"), name); });
+  }
+
+  /// free heap, largest free block and fragmentation in percent
+  void heap(const HeapSnapshot& snapshot)
+  {
+    gauge(F("heap_free_bytes"), snapshot.free);
+    gauge(F("heap_max_block_bytes"), snapshot.maxBlock);
+    gauge(F("heap_fragmentation_percent"), snapshot.fragmentation);
+  }
+
+private:
+  void printValue(int value) { printValue(static_cast<long long>(value)); }
+  void printValue(unsigned int value) { printValue(static_cast<unsigned long long>(value)); }
+  void printValue(long value) { printValue(static_cast<long long>(value)); }
+  void printValue(unsigned long value) { printValue(static_cast<unsigned long long>(value)); }
+  void printValue(double value) { out.print(value, 3); }
+
+  void printValue(long long value)
+  {
+    if (value < 0)
+    {
+      out.print('-');
+      printValue(0ull - static_cast<unsigned long long>(value));
+    }
+    else printValue(static_cast<unsigned long long>(value));
+  }
+
+  /// "Print" of older cores has no 64 bit overload
+  void printValue(unsigned long long value)
+  {
+    char digits[21];
+    char* p = digits + sizeof(digits);
+    *--p = '\0';
+    do
+    {
+      *--p = '0' + value % 10;
+      value /= 10;
+    } while (value);
+    out.print(p);
+  }
+
+  Print& out;
+};
+}
+
+#endif /* MYIOT_METRICS_H_ */
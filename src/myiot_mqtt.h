@@ -1,32 +1,42 @@
 #ifndef __MQTT_H
 #define __MQTT_H
 
-#include <functional>
 #include <PubSubClient.h>
 #include <WiFiClient.h>
 
+#include "myiot_function.h"
 #include "myiot_timer_system.h"
 
 namespace MyIOT
 {
+/// MQTT client, that subscribes and publishes "<device_name>/<topic>".
+/* Device name, server, group and topics are not copied, they have to stay valid,
+ * e.g. the fields of the "ConfigRecord" and string literals. After a change of the name, server
+ * or group call "reconnect", so that the broker subscriptions use the new names too.
+ * */
 class Mqtt : public MyIOT::ITimer
 {
-  enum {MAX_NUMBER_OF_SUBSCRIPTIONS = 5};
+  enum {MAX_NUMBER_OF_SUBSCRIPTIONS = 8};
+  enum {MAX_MESSAGES_PER_CHECK = 8};
+  /// below the keepalive of "PubSubClient" (15 s)
+  enum {MAX_HOLD_MS = 5000};
 
   
 public:
-  typedef std::function<void()> F_OnConnected;
+  typedef MyIOT::Function<void()> F_OnConnected;
+  typedef MyIOT::Function<bool()> F_Ready;
+  typedef MyIOT::Function<void(Print& out)> F_Print;
+  typedef MyIOT::Function<void(const char* message)> F_Reaction;
 
-  Mqtt():client(espClient), device_name{0}, mqtt_server{0}
+  Mqtt():client(espClient), device_name(""), mqtt_server(""), group(""), messages_in(0), messages_out(0), connects(0),
+    lastLoop(0)
   {
   }
 
   void setup(const char* deviceName, const char* mqttServer)
   {
-    strncpy(device_name, deviceName, sizeof(device_name));
-    device_name[sizeof(device_name)-1] = 0; 
-    strncpy(mqtt_server, mqttServer, sizeof(mqtt_server));
-    mqtt_server[sizeof(mqtt_server)-1] = 0; 
+    device_name = deviceName;
+    mqtt_server = mqttServer;
 
     client.setServer(mqtt_server, 1883);
     
@@ -37,14 +47,55 @@ public:
       );
   }
 
-  void publish(const char* topic, const char* message)
+  /// subscribe to "<group>/<topic>" too, e.g. to switch all bulbs of a room with one message
+  /* An empty "group" removes it. "group" is not copied, call "reconnect" after it changed.
+   * */
+  void setGroup(const char* xgroup)
   {
+    group = xgroup ? xgroup : "";
+  }
+
+  /// connect again with the current device name, server and group, e.g. after they were changed
+  /* The next "expire" connects and subscribes with the new names.
+   * */
+  void reconnect()
+  {
+    if (client.connected()) client.disconnect();
+  }
+
+  /// a "retained" message is kept by the broker and sent to every new subscriber, e.g. a state
+  void publish(const char* topic, const char* message, bool retained = false)
+  {
+    char buffer[256];
+    snprintf_P(buffer, sizeof(buffer), PSTR("%s/%s"), device_name, topic);
+    if (client.publish(buffer, message, retained)) messages_out++;
+  }
+
+  /// publish a message, that "f_print" prints, without a buffer for the whole message
+  /* "f_print" is called twice, first to measure the length, then to send, so it has to print
+   * the same both times, e.g. from a snapshot of values, that change by themselves (heap, time).
+   * Otherwise the message is cut or padded with blanks to the announced length, so the
+   * connection stays in sync.
+   * */
+  void publish(const char* topic, const F_Print& f_print, bool retained = false)
+  {
+    CountingPrint counter;
+    f_print(counter);
+
     char buffer[256];
-    snprintf(buffer, sizeof(buffer), "%s/%s", device_name, topic);
-    client.publish(buffer, message);
+    snprintf_P(buffer, sizeof(buffer), PSTR("%s/%s"), device_name, topic);
+    if (!client.beginPublish(buffer, counter.count, retained)) return;
+    LimitedPrint limited(client, counter.count);
+    f_print(limited);
+    limited.pad();
+    if (client.endPublish()) messages_out++;
   }
 
-  bool subscribe(const char* topic, std::function<void(const char* message)> reaction)
+  unsigned long get_messages_in() const { return messages_in; }
+  unsigned long get_messages_out() const { return messages_out; }
+  unsigned long get_connects() const { return connects; }
+
+  bool subscribe(const char* topic, const F_Reaction& reaction)
   {
 	 for (Subscription& sub : subscriptions)
      {
@@ -57,6 +108,11 @@ public:
      return false;
   }
 
+  bool isConnected()
+  {
+    return client.connected();
+  }
+
   virtual void expire()
   {
     check_mqtt_client();
@@ -69,52 +125,117 @@ public:
 	  OnConnected = onConnected;
   }
 
+  /// messages are only read, while "ready" returns true, then up to "MAX_MESSAGES_PER_CHECK" per "expire"
+  /* E.g. while the queue of the receiver has room, so a burst can be coalesced there and nothing is dropped.
+   * Meanwhile the messages wait at the broker, but after "MAX_HOLD_MS" one is read anyway, because only
+   * "PubSubClient::loop" keeps the connection alive, the receiver has to keep room for that one.
+   * Without "ready", one message is read per "expire".
+   * */
+  void setReady(const F_Ready& ready)
+  {
+    Ready = ready;
+  }
+
 private:
+   class CountingPrint : public Print
+   {
+   public:
+     CountingPrint(): count(0) {}
+     virtual size_t write(uint8_t) { count++; return 1; }
+     virtual size_t write(const uint8_t*, size_t size) { count += size; return size; }
+     size_t count;
+   };
+
+   /// passes at most "limit" bytes to "out"
+   class LimitedPrint : public Print
+   {
+   public:
+     LimitedPrint(Print& xout, size_t xlimit): out(xout), limit(xlimit) {}
+     virtual size_t write(uint8_t c) { return write(&c, 1); }
+     virtual size_t write(const uint8_t* data, size_t size)
+     {
+       if (size > limit) size = limit;
+       size = out.write(data, size);
+       limit -= size;
+       return size;
+     }
+     /// fill up to "limit" with blanks
+     void pad()
+     {
+       while (limit > 0 && 1 == out.write(uint8_t(' '))) limit--;
+     }
+   private:
+     Print& out;
+     size_t limit;
+   };
+
    class Subscription {
       public:
-        Subscription(): topic{0}
+        Subscription(): topic(nullptr)
         {}
-        bool empty() const { return 0 == topic[0]; }
+        bool empty() const { return nullptr == topic; }
         const char* getTopic() const {return topic;}
-        void set(const char* xtopic, std::function<void(const char* message)> fCallback)
+        void set(const char* xtopic, const F_Reaction& fCallback)
         {
-          strncpy(topic, xtopic, sizeof(topic));
-          topic[sizeof(topic)-1] = 0;
+          topic = xtopic;
           callback = fCallback;
         }
         bool equals(const char* xtopic)
         {
-          return 0 == strcmp(topic, xtopic);
+          return topic && 0 == strcmp(topic, xtopic);
         }
         void execute(const char* message)
         {
           if (callback) callback(message);
         }
       private:
-        char topic[20];
-        std::function<void(const char* message)> callback;
+        const char* topic;
+        F_Reaction callback;
    } subscriptions[MAX_NUMBER_OF_SUBSCRIPTIONS];
 
     void subscribe(const char* topic)
     {
       char buffer[256];
-      snprintf(buffer, sizeof(buffer), "%s/%s", device_name, topic);
+      snprintf_P(buffer, sizeof(buffer), PSTR("%s/%s"), device_name, topic);
       client.subscribe(buffer);
+      if (0 != group[0])
+      {
+        snprintf_P(buffer, sizeof(buffer), PSTR("%s/%s"), group, topic);
+        client.subscribe(buffer);
+      }
+    }
+
+    /// "topic" without "<device_name>/" or "<group>/", nullptr for other topics
+    const char* local_topic(const char* topic) const
+    {
+      const char* prefixes[] = {device_name, group};
+      for (const char* prefix : prefixes)
+      {
+        size_t length = strlen(prefix);
+        if (0 != length && 0 == strncmp(topic, prefix, length) && '/' == topic[length])
+        {
+          return topic + length + 1;
+        }
+      }
+      return nullptr;
     }
     
     void i_callback(char* topic, byte* payload, unsigned int length)
     {
-      info("MQTT callback: ", topic);
+      MYIOT_TRACE(TRACE_MQTT_CALLBACK_BEGIN, length);
+      info(F("MQTT callback: "), topic);
+      messages_in++;
       char buffer[256] = {0};
       strncpy(buffer, (const char*)payload,  length>sizeof(buffer) ? sizeof(buffer) : length);
-      topic = topic + strlen(device_name) + 1; // device_name + '/'
+      const char* local = local_topic(topic);
  	 for (Subscription& sub : subscriptions)
       {
-        if (sub.equals(topic))
+        if (local && sub.equals(local))
         {
           sub.execute(buffer);
         }
       }
+      MYIOT_TRACE(TRACE_MQTT_CALLBACK_END, length);
     }
 
     void register_subscriptions()
@@ -141,57 +262,76 @@ private:
         
         if (client.connect(device_name))
         {
-          info("MQTT client connected", device_name);
+          info(F("MQTT client connected"), device_name);
+          connects++;
           register_subscriptions();
           if (OnConnected) OnConnected();
         }
         else
         {
-          error("MQTT client failed to connect", device_name);
+          error(F("MQTT client failed to connect"), device_name);
         }
       }
-      else
+      else if (!Ready)
       {
         client.loop();
       }
+      else
+      {
+        // "loop" reads at most one message
+        if (!Ready() && millis() - lastLoop < MAX_HOLD_MS) return;
+        for (int i = 0; i < MAX_MESSAGES_PER_CHECK; i++)
+        {
+          unsigned long before = messages_in;
+          lastLoop = millis();
+          if (!client.loop() || before == messages_in || !Ready()) break;
+        }
+      }
     }    
 
-    void info(const char* msg1, const char* msg2 = NULL)
+    void info(const __FlashStringHelper* msg1, const char* msg2 = NULL)
     {
-      i_print("info", msg1, msg2);
+      i_print(F("info"), msg1, msg2);
     }
-    void error(const char* msg1, const char* msg2 = NULL)
+    void error(const __FlashStringHelper* msg1, const char* msg2 = NULL)
     {
-      i_print("error", msg1, msg2);
+      i_print(F("error"), msg1, msg2);
     }
 
-    void i_print(const char* type, const char* msg1, const char* msg2)
+    void i_print(const __FlashStringHelper* type, const __FlashStringHelper* msg1, const char* msg2)
     {
-      Serial.print("Mqtt ");
+      Serial.print(F("Mqtt "));
       Serial.print(device_name);
-      Serial.print(" ");
+      Serial.print(' ');
       Serial.print(type);
-      Serial.print(":");
+      Serial.print(':');
       if (msg1)
       {
-        Serial.print(" ");
+        Serial.print(' ');
         Serial.print(msg1);
       }
       if (msg2)
       {
-        Serial.print(" ");
+        Serial.print(' ');
         Serial.print(msg2);
       }
-      Serial.println("");
+      Serial.println();
     }
 
     WiFiClient espClient;
     PubSubClient client;
 
-    char device_name[64];
-    char mqtt_server[64];
+    const char* device_name;
+    const char* mqtt_server;
+    const char* group;
+
+    unsigned long messages_in;
+    unsigned long messages_out;
+    unsigned long connects;
+    unsigned long lastLoop;
 
     F_OnConnected OnConnected;
+    F_Ready Ready;
 };
 }
 #endif
@@ -3,6 +3,7 @@
 
 
 #include <ArduinoOTA.h>
+#include "myiot_function.h"
 #include "myiot_timer_system.h"
 
 namespace MyIOT
@@ -10,7 +11,13 @@ namespace MyIOT
 class OTA : public MyIOT::ITimer
 {
   public:
+  typedef MyIOT::Function<void()> F_OnRestart;
+
   OTA(){}
+
+  /// called after the image is written, before the device restarts, e.g. to save pending settings
+  void setOnRestart(const F_OnRestart& xOnRestart) { onRestart = xOnRestart; }
+
   void setup(const char* name){
 	  if (name)
 	  {
@@ -18,21 +25,22 @@ class OTA : public MyIOT::ITimer
 	  }
 
       ArduinoOTA.onStart([]() {
-        Serial.println("Start");
+        Serial.println(F("Start"));
       });
-      ArduinoOTA.onEnd([]() {
-        Serial.println("\nEnd");
+      ArduinoOTA.onEnd([this]() {
+        Serial.println(F("\nEnd"));
+        if (onRestart) onRestart();
       });
       ArduinoOTA.onProgress([](unsigned int progress, unsigned int total) {
-        Serial.printf("Progress: %u%%\r", (progress / (total / 100)));
+        Serial.printf_P(PSTR("Progress: %u%%\r"), (progress / (total / 100)));
       });
       ArduinoOTA.onError([](ota_error_t error) {
-        Serial.printf("Error[%u]: ", error);
-        if (error == OTA_AUTH_ERROR) Serial.println("Auth Failed");
-        else if (error == OTA_BEGIN_ERROR) Serial.println("Begin Failed");
-        else if (error == OTA_CONNECT_ERROR) Serial.println("Connect Failed");
-        else if (error == OTA_RECEIVE_ERROR) Serial.println("Receive Failed");
-        else if (error == OTA_END_ERROR) Serial.println("End Failed");
+        Serial.printf_P(PSTR("Error[%u]: "), error);
+        if (error == OTA_AUTH_ERROR) Serial.println(F("Auth Failed"));
+        else if (error == OTA_BEGIN_ERROR) Serial.println(F("Begin Failed"));
+        else if (error == OTA_CONNECT_ERROR) Serial.println(F("Connect Failed"));
+        else if (error == OTA_RECEIVE_ERROR) Serial.println(F("Receive Failed"));
+        else if (error == OTA_END_ERROR) Serial.println(F("End Failed"));
       });
       ArduinoOTA.begin();  
     }
@@ -41,6 +49,9 @@ class OTA : public MyIOT::ITimer
       ArduinoOTA.handle();
   }
   virtual void destroy(){}
+
+  private:
+  F_OnRestart onRestart;
 };
 }
 
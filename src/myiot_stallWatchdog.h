@@ -0,0 +1,170 @@
+/*
+ * myiot_stallWatchdog.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef MYIOT_STALLWATCHDOG_H_
+#define MYIOT_STALLWATCHDOG_H_
+
+#include <Arduino.h>
+#include <Print.h>
+#include <user_interface.h>
+
+#include "myiot_crc32.h"
+#include "myiot_timer_system.h"
+
+namespace MyIOT
+{
+/// Software watchdog for the "TimerSystem": logs every "expire", that takes longer than a threshold.
+/* The log is kept in RTC memory, so it survives resets (but not a power cycle).
+ * The name of the running timer is written to RTC memory too, so if the hardware watchdog
+ * or an exception resets the device in the middle of a callback, "setup" adds the offending timer
+ * to the log with the duration "RESET".
+ * */
+class StallWatchdog : public ITimerObserver
+{
+public:
+  enum {MAX_ENTRIES = 4, NAME_LENGTH = 12};
+  static const uint32_t RESET = 0xFFFFFFFF;
+
+  /// RTC memory blocks, after the frame of "SonoffB1"
+  static const uint32_t RTC_LOG_BLOCK = 40;
+  static const uint32_t RTC_RUNNING_BLOCK = 70;
+
+  StallWatchdog(uint32_t threshold_ms = 100): threshold_us(threshold_ms * 1000)
+  {
+    memset(&log, 0, sizeof(log));
+  }
+
+  void setup()
+  {
+    if (!ESP.rtcUserMemoryRead(RTC_LOG_BLOCK, reinterpret_cast<uint32_t*>(&log), sizeof(log))
+        || MAGIC != log.magic || log.crc != logCrc() || log.count > MAX_ENTRIES)
+    {
+      clear(); // power cycle
+    }
+
+    Running running;
+    if (ESP.rtcUserMemoryRead(RTC_RUNNING_BLOCK, reinterpret_cast<uint32_t*>(&running), sizeof(running))
+        && MAGIC == running.magic && resetByWatchdog())
+    {
+      running.name[NAME_LENGTH - 1] = 0;
+      add(running.name, RESET);
+    }
+    clearRunning();
+  }
+
+  void set_threshold_ms(uint32_t threshold_ms) { threshold_us = threshold_ms * 1000; }
+
+  size_t count() const { return log.count; }
+
+  /// one line per stall: "<timer> <milliseconds or RESET> <uptime in seconds>"
+  void print(Print& out) const
+  {
+    for (uint32_t i = 0; i < log.count; i++)
+    {
+      const Entry& entry = log.entries[i];
+      out.print(entry.name);
+      out.print(' ');
+      if (RESET == entry.duration_ms) out.print(F("RESET"));
+      else out.print(entry.duration_ms);
+      out.print(' ');
+      out.println(entry.uptime_s);
+    }
+  }
+
+  void clear()
+  {
+    memset(&log, 0, sizeof(log));
+    save();
+  }
+
+  virtual void on_begin(const char* name)
+  {
+    Running running;
+    running.magic = MAGIC;
+    strncpy(running.name, name, NAME_LENGTH - 1);
+    running.name[NAME_LENGTH - 1] = 0;
+    ESP.rtcUserMemoryWrite(RTC_RUNNING_BLOCK, reinterpret_cast<uint32_t*>(&running), sizeof(running));
+  }
+
+  virtual void on_end(const char* name, uint32_t duration_us)
+  {
+    clearRunning();
+    if (duration_us > threshold_us)
+    {
+      add(name, duration_us / 1000);
+    }
+  }
+
+private:
+  static const uint32_t MAGIC = 0x4C4C5453; // "STLL"
+
+  struct Entry
+  {
+    char name[NAME_LENGTH];
+    uint32_t duration_ms;
+    uint32_t uptime_s;
+  };
+
+  struct Log
+  {
+    uint32_t magic;
+    uint32_t crc;
+    uint32_t count;
+    Entry entries[MAX_ENTRIES];
+  };
+
+  struct Running
+  {
+    uint32_t magic;
+    char name[NAME_LENGTH];
+  };
+
+  static bool resetByWatchdog()
+  {
+    uint32_t reason = ESP.getResetInfoPtr()->reason;
+    return REASON_WDT_RST == reason || REASON_SOFT_WDT_RST == reason || REASON_EXCEPTION_RST == reason;
+  }
+
+  void clearRunning()
+  {
+    uint32_t magic = 0;
+    ESP.rtcUserMemoryWrite(RTC_RUNNING_BLOCK, &magic, sizeof(magic));
+  }
+
+  /// the oldest entry is dropped, if the log is full
+  void add(const char* name, uint32_t duration_ms)
+  {
+    if (log.count >= MAX_ENTRIES)
+    {
+      memmove(&log.entries[0], &log.entries[1], sizeof(Entry) * (MAX_ENTRIES - 1));
+      log.count = MAX_ENTRIES - 1;
+    }
+    Entry& entry = log.entries[log.count++];
+    strncpy(entry.name, name, NAME_LENGTH);
+    entry.name[NAME_LENGTH - 1] = 0;
+    entry.duration_ms = duration_ms;
+    entry.uptime_s = millis() / 1000;
+    save();
+  }
+
+  uint32_t logCrc() const
+  {
+    return crc32(&log.count, sizeof(log) - offsetof(Log, count));
+  }
+
+  void save()
+  {
+    log.magic = MAGIC;
+    log.crc = logCrc();
+    ESP.rtcUserMemoryWrite(RTC_LOG_BLOCK, reinterpret_cast<uint32_t*>(&log), sizeof(log));
+  }
+
+  uint32_t threshold_us;
+  Log log;
+};
+}
+
+#endif /* MYIOT_STALLWATCHDOG_H_ */
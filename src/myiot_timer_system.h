@@ -9,7 +9,9 @@
 #define MYIOT_TIMER_SYSTEM_H_
 
 #include <stdint.h>
-#include <functional>
+
+#include "myiot_function.h"
+#include "myiot_trace.h"
 
 namespace MyIOT
 {
@@ -29,6 +31,18 @@ public:
 };
 
 
+/// Gets notified around every "ITimer::expire", e.g. to detect callbacks, that block the loop.
+class ITimerObserver
+{
+public:
+  virtual ~ITimerObserver()
+  {
+  }
+  virtual void on_begin(const char* name) = 0;
+  virtual void on_end(const char* name, uint32_t duration_us) = 0;
+};
+
+
 /// The timer system allows the schedule several time based tasks, without consuming processing time.
 /* To define a new task, derive your task from interface "ITimer" and implement "expire" and "destroy".
  * The task will be scheduled with a "TimeSpec", i.e. the repeating interval of the task.
@@ -36,7 +50,7 @@ public:
 class TimerSystem
 {
 public:
-   typedef std::function<void()> F_Expire;
+   typedef MyIOT::Function<void()> F_Expire;
 
   class TimeSpec
   {
@@ -124,9 +138,9 @@ public:
 
     void dump()
     {
-      Serial.print("::");
+      Serial.print(F("::"));
       Serial.print((unsigned long)sec());
-      Serial.print(":");
+      Serial.print(F(":"));
       Serial.println((unsigned long)nsec());
     }
 
@@ -135,7 +149,18 @@ public:
     uint64_t tv_nsec;
   };
 
-  TimerSystem(): head(nullptr), last_wakeup(millis())
+  /// runtime statistics of one timer, in microseconds, and the lowest free heap after its "expire"
+  struct Stats
+  {
+    Stats(): calls(0), total_us(0), max_us(0), min_heap(UINT32_MAX) {}
+    unsigned long calls;
+    uint64_t total_us;
+    uint32_t max_us;
+    uint32_t min_heap;
+  };
+
+  TimerSystem(): head(nullptr), last_wakeup(millis()), iterations(0), max_loop_us(0), idle_heap(0),
+      observer(nullptr), exclusive(nullptr), exclusive_also(nullptr)
   {
   }
 
@@ -191,11 +216,14 @@ public:
     return ret;
   }
 
-  bool add(ITimer* timer, const TimeSpec& tspec)
+  /// "name" is used for statistics only, it must be a string literal (it is not copied)
+  /* A timer with an empty "tspec" is a one-shot timer, it expires only after "schedule".
+   * */
+  bool add(ITimer* timer, const TimeSpec& tspec, const char* name = "")
   {
     if (nullptr == timer)
       return false;
-    Node* node = new Node(*timer, tspec);
+    Node* node = new Node(*timer, tspec, current, name);
     if (nullptr == node)
       return false;
     if (nullptr == head)
@@ -206,9 +234,40 @@ public:
     return head->append(node);
   }
 
-  bool add(const F_Expire& f_expire, const TimeSpec& tspec)
+  /// like "add", but "timer" becomes the first one, that expires in every loop, e.g. an output stage
+  bool add_first(ITimer* timer, const TimeSpec& tspec, const char* name = "")
   {
-	  return add(new FExpireTimer(f_expire), tspec);
+    if (nullptr == timer)
+      return false;
+    Node* node = new Node(*timer, tspec, current, name);
+    if (nullptr == node)
+      return false;
+    node->set_next(head);
+    head = node;
+    return true;
+  }
+
+  bool add(const F_Expire& f_expire, const TimeSpec& tspec, const char* name = "")
+  {
+	  return add(new FExpireTimer(f_expire), tspec, name);
+  }
+
+  /// let the one-shot "timer" expire once after "delay", an earlier schedule is replaced
+  /* "schedule" may be called in "expire" of the timer itself.
+   * */
+  bool schedule(const ITimer& timer, const TimeSpec& delay)
+  {
+    for (Node* node = head; nullptr != node; node = node->get_next())
+    {
+      if (node->is_equal(timer))
+      {
+        TimeSpec at = current;
+        at += delay;
+        node->set_next_expiration(at);
+        return true;
+      }
+    }
+    return false;
   }
 
   bool remove(const ITimer& timer)
@@ -242,9 +301,12 @@ public:
   {
     for (Node* node = head; nullptr != node; node = node->get_next())
     {
+      if (nullptr != exclusive && !node->is_equal(*exclusive)
+          && (nullptr == exclusive_also || !node->is_equal(*exclusive_also)))
+        continue;
       if (node->should_expire(now))
       {
-        node->expire();
+        node->expire(observer);
         node->calc_next_expiration(now);
       }
     }
@@ -258,8 +320,56 @@ public:
       unsigned long addval = curval - last_wakeup;
       last_wakeup = curval;
       this->current.add_milliseconds(addval);
+      uint32_t start = micros();
       expire(this->current);
-      delay(tick_in_milliseconds);
+      uint32_t duration = micros() - start;
+      if (duration > max_loop_us) max_loop_us = duration;
+      idle_heap = ESP.getFreeHeap();
+      iterations++;
+      delay(nullptr != exclusive ? 0 : tick_in_milliseconds);
+    }
+  }
+
+  /// number of loop iterations since start
+  unsigned long get_iterations() const { return iterations; }
+
+  /// longest loop iteration without the tick delay, in microseconds
+  uint32_t get_max_loop_us() const { return max_loop_us; }
+
+  /// free heap after the last loop iteration, when all timers are done
+  uint32_t get_idle_heap() const { return idle_heap; }
+
+  /// lowest free heap after any timer since start
+  uint32_t get_min_heap() const
+  {
+    uint32_t ret = UINT32_MAX;
+    for (const Node* node = head; nullptr != node; node = node->get_next())
+    {
+      if (node->get_stats().min_heap < ret) ret = node->get_stats().min_heap;
+    }
+    return UINT32_MAX == ret ? idle_heap : ret;
+  }
+
+  /// "observer" is called around every expire, nullptr removes it
+  void set_observer(ITimerObserver* xobserver) { observer = xobserver; }
+
+  /// while "timer" is set, all other timers except "also" are paused and the loop doesn't sleep
+  /* E.g. an update gets all the CPU time, but MQTT ("also") keeps its connection alive.
+   * The paused timers expire once, when "timer" is reset to nullptr.
+   * */
+  void set_exclusive(const ITimer* timer, const ITimer* also = nullptr)
+  {
+    exclusive = timer;
+    exclusive_also = also;
+  }
+
+  /// call "f(name, stats)" for every timer
+  template <typename F>
+  void for_each_timer(F f) const
+  {
+    for (const Node* node = head; nullptr != node; node = node->get_next())
+    {
+      f(node->get_name(), node->get_stats());
     }
   }
 
@@ -267,8 +377,9 @@ private:
   class Node
   {
   public:
-    Node(ITimer& xtimer, const TimeSpec& xtspec) :
-        next(nullptr), timer(xtimer), tspec(xtspec)
+    Node(ITimer& xtimer, const TimeSpec& xtspec, const TimeSpec& now, const char* xname) :
+        next(nullptr), timer(xtimer), tspec(xtspec), next_expiration(is_one_shot() ? never() : now), name(xname),
+        label(Trace::instance().label(xname))
     {
     }
     ~Node()
@@ -310,13 +421,48 @@ private:
       return (now >= next_expiration);
     }
 
-    void expire()
+    void expire(ITimerObserver* observer)
     {
+      MYIOT_TRACE(TRACE_TIMER_BEGIN, label);
+      if (observer) observer->on_begin(name);
+      uint32_t start = micros();
       timer.expire();
+      uint32_t duration = micros() - start;
+      if (observer) observer->on_end(name, duration);
+      MYIOT_TRACE(TRACE_TIMER_END, label);
+      stats.calls++;
+      stats.total_us += duration;
+      if (duration > stats.max_us) stats.max_us = duration;
+      uint32_t heap = ESP.getFreeHeap();
+      if (heap < stats.min_heap) stats.min_heap = heap;
+    }
+
+    const char* get_name() const
+    {
+      return name;
+    }
+    const Stats& get_stats() const
+    {
+      return stats;
+    }
+
+    bool is_one_shot() const
+    {
+      return TimeSpec() == tspec;
+    }
+
+    void set_next_expiration(const TimeSpec& at)
+    {
+      next_expiration = at;
     }
 
     void calc_next_expiration(const TimeSpec& now)
     {
+      if (is_one_shot())
+      {
+        if (now >= next_expiration) next_expiration = never(); // not scheduled again in "expire"
+        return;
+      }
       while (now >= next_expiration)
       {
         next_expiration += tspec;
@@ -324,10 +470,18 @@ private:
     }
 
   private:
+    static TimeSpec never()
+    {
+      return TimeSpec(~0ull, 0);
+    }
+
     Node* next;
     ITimer& timer;
     TimeSpec tspec;
     TimeSpec next_expiration;
+    const char* name;
+    uint16_t label;
+    Stats stats;
   };
 
   class FExpireTimer : public ITimer
@@ -344,6 +498,12 @@ private:
   Node * head;
   TimeSpec current;
   unsigned long last_wakeup;
+  unsigned long iterations;
+  uint32_t max_loop_us;
+  uint32_t idle_heap;
+  ITimerObserver* observer;
+  const ITimer* exclusive;
+  const ITimer* exclusive_also;
 };
 
 } // namespace MyIOT
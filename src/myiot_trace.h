@@ -0,0 +1,133 @@
+/*
+ * myiot_trace.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef MYIOT_TRACE_H_
+#define MYIOT_TRACE_H_
+
+#include <Arduino.h>
+#include <Print.h>
+
+namespace MyIOT
+{
+enum TraceEvent
+{
+  TRACE_TIMER_BEGIN = 1,         // arg: label of the timer
+  TRACE_TIMER_END = 2,
+  TRACE_MQTT_CALLBACK_BEGIN = 3, // arg: payload length
+  TRACE_MQTT_CALLBACK_END = 4,
+  TRACE_LED_UPDATE_BEGIN = 5,    // arg: number of updates (low 16 bit)
+  TRACE_LED_UPDATE_END = 6,
+  TRACE_SUNRISE_EXPIRE = 7,      // arg: sunrise value
+};
+
+/// Fixed-size ring buffer of hot path events with cycle counter timestamps.
+/* "record" takes a few dozen cycles: interrupts are masked only while a slot is reserved,
+ * so events from interrupts and from the loop can't get the same slot.
+ * The oldest entries are overwritten.
+ *
+ * "dump" writes the binary format (little endian), that "tools/trace2chrome.py" decodes:
+ *   header:  "MTRC", uint16 version, uint16 entry size, uint32 cpu MHz, uint32 number of entries
+ *   entries: uint32 cycles, uint16 event, uint16 arg  (oldest first)
+ *   labels:  uint16 number of labels, then per label: uint16 id, uint8 length, chars
+ *
+ * Define "MYIOT_TRACE_DISABLED" to compile the trace points out.
+ * */
+class Trace
+{
+public:
+  enum {CAPACITY = 128}; // must be a power of 2
+  enum {MAX_LABELS = 24};
+  enum {VERSION = 1};
+
+  struct Entry
+  {
+    uint32_t cycles;
+    uint16_t event;
+    uint16_t arg;
+  };
+
+  static Trace& instance()
+  {
+    static Trace trace;
+    return trace;
+  }
+
+  __attribute__((always_inline)) inline void record(uint16_t event, uint16_t arg)
+  {
+    if (!enabled) return;
+    uint32_t savedPs = xt_rsil(15);
+    uint32_t index = head++;
+    xt_wsr_ps(savedPs);
+    Entry& entry = entries[index & (CAPACITY - 1)];
+    entry.cycles = ESP.getCycleCount();
+    entry.event = event;
+    entry.arg = arg;
+  }
+
+  /// id for "name", that is used as "arg" of an event, e.g. the name of a timer
+  /* "name" must be a string literal, it is not copied.
+   * */
+  uint16_t label(const char* name)
+  {
+    if (labelCount >= MAX_LABELS) return 0;
+    labels[labelCount] = name;
+    return ++labelCount;
+  }
+
+  /// stop recording, e.g. while dumping
+  void setEnabled(bool enable) { enabled = enable; }
+
+  void dump(Print& out) const
+  {
+    uint32_t first = head > CAPACITY ? head - CAPACITY : 0;
+    uint32_t count = head - first;
+
+    out.write(reinterpret_cast<const uint8_t*>("MTRC"), 4);
+    writeValue(out, uint16_t(VERSION));
+    writeValue(out, uint16_t(sizeof(Entry)));
+    writeValue(out, uint32_t(ESP.getCpuFreqMHz()));
+    writeValue(out, count);
+    for (uint32_t index = first; index != head; index++)
+    {
+      out.write(reinterpret_cast<const uint8_t*>(&entries[index & (CAPACITY - 1)]), sizeof(Entry));
+    }
+
+    writeValue(out, labelCount);
+    for (uint16_t i = 0; i < labelCount; i++)
+    {
+      uint8_t length = strlen(labels[i]);
+      writeValue(out, uint16_t(i + 1));
+      writeValue(out, length);
+      out.write(reinterpret_cast<const uint8_t*>(labels[i]), length);
+    }
+  }
+
+private:
+  Trace(): head(0), enabled(true), labelCount(0)
+  {
+  }
+
+  template <typename T>
+  static void writeValue(Print& out, T value)
+  {
+    out.write(reinterpret_cast<const uint8_t*>(&value), sizeof(value)); // the ESP8266 is little endian
+  }
+
+  Entry entries[CAPACITY];
+  volatile uint32_t head;
+  volatile bool enabled;
+  const char* labels[MAX_LABELS];
+  uint16_t labelCount;
+};
+}
+
+#if defined(MYIOT_TRACE_DISABLED)
+#define MYIOT_TRACE(event, arg)
+#else
+#define MYIOT_TRACE(event, arg) MyIOT::Trace::instance().record((event), (arg))
+#endif
+
+#endif /* MYIOT_TRACE_H_ */
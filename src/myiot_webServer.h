@@ -5,23 +5,69 @@
 #include <ESP8266WebServer.h>
 
 #include "myiot_DeviceConfig.h"
+#include "myiot_function.h"
+#include "myiot_ResponseStream.h"
 #include "myiot_timer_system.h"
 
 namespace MyIOT
 {
+static const char STATUS_PAGE[] PROGMEM = "<!DOCTYPE html>\r\n<html>\r\n\
+<head><title>Configuration %name%</title></head>\r\n\
+<body><form action=\"save\" method=\"GET\">\
+  DeviceName <INPUT type=\"text\" name=\"deviceName\" value=\"%name%\"><br> \
+  MQTT Server <INPUT type=\"text\" name=\"mqttServer\" value=\"%mqtt%\"><br> \
+  <INPUT type=\"submit\" value=\"Save\"><br>\
+  </form>\
+  <form action=\"reset\" method=\"GET\"><INPUT type=\"submit\" value=\"Reset\"><br></form>\
+  <hr>\
+  <form>\
+  MQTT IP Address <INPUT readonly type=\"text\" name=\"ip\" value=\"%ip%\"><br> \
+  MQTT MAC Address <INPUT readonly type=\"text\" name=\"mac\" value=\"%mac%\"><br> \
+  MQTT Flash Size <INPUT readonly type=\"text\" name=\"flashSize\" value=\"%flash%\"><br> \
+  MQTT Real Flash Size <INPUT readonly type=\"text\" name=\"realFlashSize\" value=\"%realFlash%\"><br> \
+  Receive Signal Strength (RSSI) <INPUT readonly type=\"text\" name=\"rssi\" value=\"%rssi%\"><br> \
+  Free Heap <INPUT readonly type=\"text\" name=\"heap\" value=\"%heap%\"><br> \
+  Max Heap per Request <INPUT readonly type=\"text\" name=\"requestHeap\" value=\"%requestHeap%\"><br> \
+  </form>\
+</body> \
+</html>";
+
+static const char SAVE_PAGE[] PROGMEM = "<!DOCTYPE html>\r\n<html>\r\n\
+<head><title>Configuration %name%</title></head>\r\n\
+<body>Values saved<br>\
+<a href=\"/\">Show Values</a><br>\
+<a href=\"/reset\">Reset Device</a><br>\
+</body></html>\
+";
+
+static const char RESET_PAGE[] PROGMEM = "<!DOCTYPE html>\r\n<html>\r\n\
+<head><title>Configuration %name%</title></head>\r\n\
+<body>Reset device ...<br>\
+<a href=\"/\">Show Values</a><br>\
+</body></html>\
+";
+
 class WebServer : public MyIOT::ITimer 
 {
 public:
 
-  WebServer():server(80), config(nullptr){}
+  typedef std::function<void()> F_Handler;
+  typedef MyIOT::Function<void()> F_OnChange;
+
+  WebServer():server(80), config(nullptr), maxRequestHeap(0){}
 
   void setup(MyIOT::DeviceConfig& rconfig)
   {
     config = &rconfig;
 
+    static const char* headers[] = {"If-None-Match"};
+    server.collectHeaders(headers, sizeof(headers) / sizeof(headers[0]));
+
     server.on("/", [this](){ this->printStatus();} );
     server.on("/save", [this](){ this->handleSave();} );
     server.on("/reset", [this](){ this->handleReset();} );
+    server.on("/config.json", HTTP_GET, [this](){ this->handleConfigExport();} );
+    server.on("/config.json", HTTP_POST, [this](){ this->handleConfigImport();} );
     server.begin();
   }
 
@@ -32,71 +78,134 @@ public:
 
   virtual void destroy(){}
 
-private:
+  /// register an additional handler, e.g. for a REST API of the application
+  void on(const char* uri, HTTPMethod method, const F_Handler& handler)
+  {
+    server.on(uri, method, handler);
+  }
 
-  void printStatus()
+  ESP8266WebServer& getServer() { return server; }
+
+  /// called after the settings were changed by "POST /config.json" or "/save", e.g. to apply them
+  void setOnChange(const F_OnChange& xOnChange) { onChange = xOnChange; }
+
+  /// answer with "304 Not Modified", if the client has the resource with "etag" already
+  /* Otherwise the "ETag" header is set for the following response and false is returned.
+   * */
+  bool notModified(uint32_t etag)
   {
-    IPAddress ip = WiFi.localIP();
-    String mac = WiFi.macAddress();
+    char value[12];
+    snprintf_P(value, sizeof(value), PSTR("\"%08x\""), etag);
+    server.sendHeader("ETag", value);
+    if (server.hasHeader("If-None-Match") && server.header("If-None-Match") == value)
+    {
+      server.send(304);
+      return true;
+    }
+    return false;
+  }
 
-    uint32_t flashSize = ESP.getFlashChipSize();
-    String  sFlashSize(flashSize);
+  /// send "json" without building a String
+  void sendJson(int code, JsonObject& json)
+  {
+    ResponseStream out(server);
+    out.begin(code, PSTR("application/json"));
+    json.printTo(out);
+    out.end();
+    trackHeap(out);
+  }
 
-    uint32_t realFlashSize = ESP.getFlashChipRealSize();
-    String sRealFlashSize(realFlashSize);
+private:
 
-    int32_t rssi = WiFi.RSSI(); // receive signal strength
-    String sRSSI(rssi);
+  void printStatus()
+  {
+    ResponseStream out(server);
+    out.begin(200, PSTR("text/html"));
+    out.render(STATUS_PAGE, [this](ResponseStream& stream, const char* name){ this->printValue(stream, name);});
+    out.end();
+    trackHeap(out);
+  }
 
-    String html1 = "<!DOCTYPE html>\r\n<html>\r\n\
-<head><title>Configuration " + String(config->getDeviceName())+ "</title></head>\r\n\
-<body><form action=\"save\" method=\"GET\">\
-  DeviceName <INPUT type=\"text\" name=\"deviceName\" value=\"" + String(config->getDeviceName()) + "\"><br> \
-  MQTT Server <INPUT type=\"text\" name=\"mqttServer\" value=\"" + String(config->getMqttServer()) + "\"><br> \
-  <INPUT type=\"submit\" value=\"Save\"><br>\
-  </form>\
-  <form action=\"reset\" method=\"GET\"><INPUT type=\"submit\" value=\"Reset\"><br></form>\
-  <hr>\
-  <form>\
-  MQTT IP Address <INPUT readonly type=\"text\" name=\"ip\" value=\"" + ip.toString() + "\"><br> \
-  MQTT MAC Address <INPUT readonly type=\"text\" name=\"mac\" value=\"" + mac + "\"><br> \
-  MQTT Flash Size <INPUT readonly type=\"text\" name=\"flashSize\" value=\"" + sFlashSize + "\"><br> \
-  MQTT Real Flash Size <INPUT readonly type=\"text\" name=\"realFlashSize\" value=\"" + sRealFlashSize + "\"><br> \
-  Receive Signal Strength (RSSI) <INPUT readonly type=\"text\" name=\"rssi\" value=\"" + sRSSI + "\"><br> \
-  </form>\
-</body> \
-</html>";
-    server.send(200, "text/html", html1);
+  void printValue(ResponseStream& out, const char* name)
+  {
+    if (0 == strcmp(name, "name")) out.printEscaped(config->getDeviceName());
+    else if (0 == strcmp(name, "mqtt")) out.printEscaped(config->getMqttServer());
+    else if (0 == strcmp(name, "ip")) out.print(WiFi.localIP());
+    else if (0 == strcmp(name, "mac"))
+    {
+      uint8_t mac[6];
+      WiFi.macAddress(mac);
+      out.printf_P(PSTR("%02X:%02X:%02X:%02X:%02X:%02X"), mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    }
+    else if (0 == strcmp(name, "flash")) out.print(ESP.getFlashChipSize());
+    else if (0 == strcmp(name, "realFlash")) out.print(ESP.getFlashChipRealSize());
+    else if (0 == strcmp(name, "rssi")) out.print(WiFi.RSSI()); // receive signal strength
+    else if (0 == strcmp(name, "heap")) out.print(ESP.getFreeHeap());
+    else if (0 == strcmp(name, "requestHeap")) out.print(maxRequestHeap);
+  }
+
+  /// keep the highest heap usage of a single response
+  void trackHeap(const ResponseStream& out)
+  {
+    if (out.getHeapUsed() > maxRequestHeap) maxRequestHeap = out.getHeapUsed();
   }
 
   void handleSave()
   {
-    String deviceName = server.arg("deviceName");
-    String mqttServer = server.arg("mqttServer");
-    config->setDeviceName(deviceName.c_str());
-    config->setMqttServer(mqttServer.c_str());
+    config->setDeviceName(server.arg("deviceName").c_str());
+    config->setMqttServer(server.arg("mqttServer").c_str());
     config->save();
+    if (onChange) onChange();
 
-    String html1 = "<!DOCTYPE html>\r\n<html>\r\n\
-<head><title>Configuration " + String(config->getDeviceName())+ "</title></head>\r\n\
-<body>Values saved<br>\
-<a href=\"/\">Show Values</a><br>\
-<a href=\"/reset\">Reset Device</a><br>\
-</body></html>\
-";
-    server.send(200, "text/html", html1);
+    ResponseStream out(server);
+    out.begin(200, PSTR("text/html"));
+    out.render(SAVE_PAGE, [this](ResponseStream& stream, const char* name){ this->printValue(stream, name);});
+    out.end();
+    trackHeap(out);
   }
 
-  void handleReset()
+  /// all persistent settings as JSON
+  void handleConfigExport()
   {
-    String html1 = "<!DOCTYPE html>\r\n<html>\r\n\
-<head><title>Configuration " + String(config->getDeviceName())+ "</title></head>\r\n\
-<body>Reset device ...<br>\
-<a href=\"/\">Show Values</a><br>\
-</body></html>\
-";
+    StaticJsonBuffer<ConfigStore::JSON_CAPACITY> jsonBuffer;
+    JsonObject& json = jsonBuffer.createObject();
+    config->getStore().exportJson(json);
+    sendJson(200, json);
+  }
+
+  /// import settings from the JSON request body, missing fields are not changed
+  void handleConfigImport()
+  {
+    char buffer[ConfigStore::MAX_JSON_LENGTH + 1] = {0}; // parsed in place, without copies
+    const String& body = server.arg("plain");
+    if (body.length() >= sizeof(buffer))
+    {
+      server.send_P(413, PSTR("text/plain"), PSTR("too large"));
+      return;
+    }
+    body.toCharArray(buffer, sizeof(buffer));
+
+    StaticJsonBuffer<ConfigStore::JSON_CAPACITY> jsonBuffer;
+    JsonObject& json = jsonBuffer.parseObject(buffer);
+    if (!json.success())
+    {
+      server.send_P(400, PSTR("text/plain"), PSTR("invalid JSON"));
+      return;
+    }
+    config->getStore().importJson(json);
+    config->getStore().flush();
+    if (onChange) onChange();
+    server.send_P(200, PSTR("text/plain"), PSTR("Values saved"));
+  }
 
-    server.send(200, "text/html", html1);
+  void handleReset()
+  {
+    {
+      ResponseStream out(server);
+      out.begin(200, PSTR("text/html"));
+      out.render(RESET_PAGE, [this](ResponseStream& stream, const char* name){ this->printValue(stream, name);});
+    }
+    config->getStore().flush(); // changes of the last seconds are not written yet
     delay(1000);
     ESP.reset();
     delay(1000);    
@@ -104,6 +213,8 @@ private:
 
   ESP8266WebServer server; 
   MyIOT::DeviceConfig* config;
+  uint32_t maxRequestHeap;
+  F_OnChange onChange;
 };
 }
 #endif
@@ -0,0 +1,152 @@
+/*
+ * myiot_webSocket.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef MYIOT_WEBSOCKET_H_
+#define MYIOT_WEBSOCKET_H_
+
+#include <WebSocketsServer.h>
+
+#include "myiot_function.h"
+#include "myiot_timer_system.h"
+
+namespace MyIOT
+{
+/// WebSocket endpoint for a persistent, low latency control channel.
+/* At most "MAX_CLIENTS" clients are accepted, further connections are closed.
+ * Every client has a send buffer of "SEND_BUFFER_SIZE" bytes, "broadcast" appends a message to it
+ * and "expire" sends the buffered messages. If a buffer is full, the message is dropped for this client,
+ * so a slow client never blocks the loop.
+ * */
+class WebSocketServer : public MyIOT::ITimer
+{
+public:
+  enum {MAX_CLIENTS = 3, SEND_BUFFER_SIZE = 256};
+  enum {DEFAULT_PORT = 81};
+
+  typedef MyIOT::Function<void(const char* message, size_t length)> F_OnText;
+  typedef MyIOT::Function<void(const uint8_t* data, size_t length)> F_OnBinary;
+  typedef MyIOT::Function<void(uint8_t client)> F_OnConnected;
+
+  WebSocketServer(uint16_t port = DEFAULT_PORT): server(port), dropped(0)
+  {
+  }
+
+  void setup()
+  {
+    server.onEvent([this](uint8_t num, WStype_t type, uint8_t* payload, size_t length)
+                   { this->onEvent(num, type, payload, length); });
+    server.begin();
+  }
+
+  void setOnText(const F_OnText& xOnText) { onText = xOnText; }
+  void setOnBinary(const F_OnBinary& xOnBinary) { onBinary = xOnBinary; }
+  void setOnConnected(const F_OnConnected& xOnConnected) { onConnected = xOnConnected; }
+
+  /// queue "message" for all connected clients
+  void broadcast(const char* message)
+  {
+    for (uint8_t num = 0; num < MAX_CLIENTS; num++)
+    {
+      send(num, message);
+    }
+  }
+
+  /// queue "message" for one client
+  void send(uint8_t num, const char* message)
+  {
+    if (num >= MAX_CLIENTS || !clients[num].connected) return;
+    if (!clients[num].append(message)) dropped++;
+  }
+
+  size_t getClients() const
+  {
+    size_t ret = 0;
+    for (const Client& client : clients)
+    {
+      if (client.connected) ret++;
+    }
+    return ret;
+  }
+
+  unsigned long getDropped() const { return dropped; }
+
+  virtual void expire()
+  {
+    server.loop();
+    for (uint8_t num = 0; num < MAX_CLIENTS; num++)
+    {
+      Client& client = clients[num];
+      for (size_t pos = 0; pos < client.length; )
+      {
+        size_t length = strlen(client.buffer + pos);
+        server.sendTXT(num, client.buffer + pos, length);
+        pos += length + 1;
+      }
+      client.length = 0;
+    }
+  }
+
+  virtual void destroy(){}
+
+private:
+  class Client
+  {
+  public:
+    Client(): connected(false), length(0){}
+
+    /// store "message" with its terminating 0
+    bool append(const char* message)
+    {
+      size_t messageLength = strlen(message) + 1;
+      if (length + messageLength > sizeof(buffer)) return false;
+      memcpy(buffer + length, message, messageLength);
+      length += messageLength;
+      return true;
+    }
+
+    bool connected;
+    size_t length;
+    char buffer[SEND_BUFFER_SIZE];
+  } clients[MAX_CLIENTS];
+
+  void onEvent(uint8_t num, WStype_t type, uint8_t* payload, size_t length)
+  {
+    switch (type)
+    {
+    case WStype_CONNECTED:
+      if (num >= MAX_CLIENTS)
+      {
+        server.disconnect(num);
+        return;
+      }
+      clients[num].connected = true;
+      clients[num].length = 0;
+      if (onConnected) onConnected(num);
+      break;
+    case WStype_DISCONNECTED:
+      if (num < MAX_CLIENTS) clients[num].connected = false;
+      break;
+    case WStype_TEXT:
+      if (num < MAX_CLIENTS && onText) onText(reinterpret_cast<const char*>(payload), length);
+      break;
+    case WStype_BIN:
+      if (num < MAX_CLIENTS && onBinary) onBinary(payload, length);
+      break;
+    default:
+      break;
+    }
+  }
+
+  WebSocketsServer server;
+  unsigned long dropped;
+
+  F_OnText onText;
+  F_OnBinary onBinary;
+  F_OnConnected onConnected;
+};
+}
+
+#endif /* MYIOT_WEBSOCKET_H_ */
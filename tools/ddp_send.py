@@ -0,0 +1,45 @@
+#!/usr/bin/env python3
+"""Send DDP frames to a bulb, e.g. to test the realtime receiver from a Linux host.
+
+    ddp_send.py <host> [--offset N] [--fps 40] [--seconds 10]
+
+Fades the five channels (c,w,r,g,b) starting at channel OFFSET through a color wheel.
+"""
+import argparse
+import math
+import socket
+import struct
+import time
+
+DDP_PORT = 4048
+FLAG_VERSION_1 = 0x40
+FLAG_PUSH = 0x01
+ID_DISPLAY = 1
+
+
+def packet(sequence, offset, data):
+    header = struct.pack(">BBBBIH", FLAG_VERSION_1 | FLAG_PUSH, sequence, 0, ID_DISPLAY, offset, len(data))
+    return header + bytes(data)
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("host")
+    parser.add_argument("--port", type=int, default=DDP_PORT)
+    parser.add_argument("--offset", type=int, default=0)
+    parser.add_argument("--fps", type=float, default=40)
+    parser.add_argument("--seconds", type=float, default=10)
+    args = parser.parse_args()
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    frames = int(args.fps * args.seconds)
+    for i in range(frames):
+        phase = 2 * math.pi * i / (args.fps * 3)
+        r, g, b = (int(127 + 127 * math.sin(phase + k * 2 * math.pi / 3)) for k in range(3))
+        sequence = i % 15 + 1
+        sock.sendto(packet(sequence, args.offset, [0, 0, r, g, b]), (args.host, args.port))
+        time.sleep(1 / args.fps)
+
+
+if __name__ == "__main__":
+    main()
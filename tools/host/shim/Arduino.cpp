@@ -0,0 +1,166 @@
+/*
+ * Arduino.cpp
+ *
+ *  Created on: 19.10.2026
+ */
+
+#include <Arduino.h>
+#include <FS.h>
+
+#include <new>
+#include <sys/time.h>
+#include <time.h>
+
+namespace
+{
+uint64_t nowUs = 0;
+int64_t wallOffsetUs = 0;  // wall clock minus simulated clock
+bool serialEnabled = false;
+
+bool heapCounted = false;
+size_t heapUsed = 0;
+size_t heapBlocks = 0;
+size_t heapPeak = 0;
+
+/// in front of every block, so "delete" knows its size and whether it was counted
+struct alignas(16) BlockHeader
+{
+  size_t size;
+  bool counted;
+};
+
+uint8_t rtcMemory[512];
+bool rtcValid = false;
+rst_info resetInfo = {REASON_SOFT_RESTART, 0, 0, 0, 0, 0, 0};
+
+void* allocate(size_t size)
+{
+  BlockHeader* header = static_cast<BlockHeader*>(malloc(sizeof(BlockHeader) + size));
+  if (nullptr == header) return nullptr;
+  header->size = size;
+  header->counted = heapCounted;
+  if (heapCounted)
+  {
+    heapUsed += size;
+    heapBlocks++;
+    if (heapUsed > heapPeak) heapPeak = heapUsed;
+  }
+  return header + 1;
+}
+
+void release(void* block)
+{
+  if (nullptr == block) return;
+  BlockHeader* header = static_cast<BlockHeader*>(block) - 1;
+  if (header->counted)
+  {
+    heapUsed -= header->size;
+    heapBlocks--;
+  }
+  free(header);
+}
+}
+
+namespace Host
+{
+uint64_t now_us() { return nowUs; }
+void advance(uint64_t us) { nowUs += us; }
+
+size_t heap_used() { return heapUsed; }
+size_t heap_blocks() { return heapBlocks; }
+size_t heap_peak() { return heapPeak; }
+
+HeapScope::HeapScope(bool counted) : previous(heapCounted) { heapCounted = counted; }
+HeapScope::~HeapScope() { heapCounted = previous; }
+
+void set_serial(bool enable) { serialEnabled = enable; }
+}
+
+void* operator new(size_t size)
+{
+  void* block = allocate(size);
+  if (nullptr == block) throw std::bad_alloc();
+  return block;
+}
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void operator delete(void* block) noexcept { release(block); }
+void operator delete[](void* block) noexcept { release(block); }
+void operator delete(void* block, size_t) noexcept { release(block); }
+void operator delete[](void* block, size_t) noexcept { release(block); }
+
+HardwareSerial Serial;
+EspClass ESP;
+FS SPIFFS;
+
+size_t HardwareSerial::write(uint8_t c)
+{
+  if (serialEnabled) fputc(c, stdout);
+  return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size)
+{
+  if (serialEnabled) fwrite(buffer, 1, size, stdout);
+  return size;
+}
+
+uint32_t EspClass::getFreeHeap()
+{
+  return heapUsed < Host::HEAP_SIZE ? Host::HEAP_SIZE - heapUsed : 0;
+}
+
+/// RTC memory keeps its content over a restart, "offset" is in blocks of 4 bytes
+bool EspClass::rtcUserMemoryRead(uint32_t offset, uint32_t* data, size_t size)
+{
+  if (!rtcValid || 4 * offset + size > sizeof(rtcMemory)) return false;
+  memcpy(data, rtcMemory + 4 * offset, size);
+  return true;
+}
+
+bool EspClass::rtcUserMemoryWrite(uint32_t offset, uint32_t* data, size_t size)
+{
+  if (4 * offset + size > sizeof(rtcMemory)) return false;
+  memcpy(rtcMemory + 4 * offset, data, size);
+  rtcValid = true;
+  return true;
+}
+
+rst_info* EspClass::getResetInfoPtr()
+{
+  return &resetInfo;
+}
+
+/// the simulated clock starts at "START_EPOCH", also after a restart of the bulb
+void configTime(long, int, const char*, const char*, const char*)
+{
+  wallOffsetUs = int64_t(Host::START_EPOCH * 1000000ull);
+}
+
+/* The linker redirects the calls of the firmware to these (-Wl,--wrap=time,...), so the wall clock
+ * follows the simulated clock.
+ * */
+extern "C"
+{
+time_t __wrap_time(time_t* result)
+{
+  time_t now = (int64_t(nowUs) + wallOffsetUs) / 1000000;
+  if (result) *result = now;
+  return now;
+}
+
+int __wrap_gettimeofday(struct timeval* tv, void*)
+{
+  int64_t us = int64_t(nowUs) + wallOffsetUs;
+  tv->tv_sec = us / 1000000;
+  tv->tv_usec = us % 1000000;
+  return 0;
+}
+
+int __wrap_settimeofday(const struct timeval* tv, const void*)
+{
+  wallOffsetUs = int64_t(tv->tv_sec) * 1000000 + tv->tv_usec - int64_t(nowUs);
+  return 0;
+}
+}
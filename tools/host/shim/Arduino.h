@@ -0,0 +1,129 @@
+/*
+ * Arduino.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef HOST_ARDUINO_H_
+#define HOST_ARDUINO_H_
+
+/// Host shim of the ESP8266 Arduino core, just enough for the firmware classes, see "tools/host/soak.cpp".
+/* "millis", "micros" and "delay" use a simulated clock, that only "delay" and "Host::advance" move,
+ * so a run is deterministic and a day takes seconds. The wall clock ("time", "gettimeofday") follows it,
+ * the linker wraps the libc functions (see the Makefile). Flash is ordinary memory, the "_P" functions
+ * are their RAM versions. "ESP" counts the heap through the global "operator new".
+ * */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <algorithm>
+
+#include "Print.h"
+#include "user_interface.h"
+
+using std::min;
+using std::max;
+
+typedef uint8_t byte;
+
+#define PROGMEM
+#define PGM_P const char*
+#define PSTR(s) (s)
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(PSTR(s)))
+#define FPSTR(p) (reinterpret_cast<const __FlashStringHelper*>(p))
+#define memcpy_P memcpy
+#define strlen_P strlen
+#define strncpy_P strncpy
+#define strcmp_P strcmp
+#define strcasecmp_P strcasecmp
+#define snprintf_P snprintf
+#define sprintf_P sprintf
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+#define OUTPUT 0x01
+#define INPUT 0x00
+
+namespace Host
+{
+/// simulated time since the start, in microseconds
+uint64_t now_us();
+
+/// move the simulated clock forward
+void advance(uint64_t us);
+
+/// bytes and blocks allocated with "new" within a counted "HeapScope" and not deleted yet, and the most bytes at any time
+size_t heap_used();
+size_t heap_blocks();
+size_t heap_peak();
+
+/// the RAM of the ESP8266, that is left for the heap, "ESP.getFreeHeap" is this minus "heap_used"
+const size_t HEAP_SIZE = 48 * 1024;
+
+/// Allocations of the bulb are counted, those of the shim and the driver are not.
+/* E.g. "HeapScope bulb(true)" around the calls into the firmware classes, "HeapScope host(false)" in the shim.
+ * */
+class HeapScope
+{
+public:
+  explicit HeapScope(bool counted);
+  ~HeapScope();
+private:
+  bool previous;
+};
+
+/// the simulated wall clock starts at this time (UTC), when SNTP "answers" in "configTime"
+const uint64_t START_EPOCH = 1792368000ull; // Monday, 19.10.2026
+
+/// Serial output is dropped, unless it is enabled, e.g. with "--verbose"
+void set_serial(bool enable);
+}
+
+inline unsigned long millis() { return Host::now_us() / 1000; }
+inline unsigned long micros() { return Host::now_us(); }
+inline void delay(unsigned long ms) { Host::advance(ms * 1000ull); }
+inline void yield() {}
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void analogWrite(uint8_t, int) {}
+inline void analogWriteRange(uint32_t) {}
+
+inline uint32_t xt_rsil(int) { return 0; }
+inline void xt_wsr_ps(uint32_t) {}
+
+/// SNTP answers at once, with the start time of the simulation
+void configTime(long gmtOffset, int daylightOffset, const char* server1, const char* server2 = nullptr,
+                const char* server3 = nullptr);
+
+class HardwareSerial : public Print
+{
+public:
+  void begin(unsigned long) {}
+  virtual size_t write(uint8_t c);
+  virtual size_t write(const uint8_t* buffer, size_t size);
+  using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+class EspClass
+{
+public:
+  uint32_t getFreeHeap();
+  uint32_t getMaxFreeBlockSize() { return getFreeHeap(); } // the host heap doesn't fragment the simulated one
+  uint8_t getHeapFragmentation() { return 0; }
+  uint32_t getCycleCount() { return uint32_t(Host::now_us() * getCpuFreqMHz()); }
+  uint8_t getCpuFreqMHz() { return 80; }
+  bool rtcUserMemoryRead(uint32_t offset, uint32_t* data, size_t size);
+  bool rtcUserMemoryWrite(uint32_t offset, uint32_t* data, size_t size);
+  rst_info* getResetInfoPtr();
+};
+
+extern EspClass ESP;
+
+#endif /* HOST_ARDUINO_H_ */
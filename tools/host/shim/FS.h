@@ -0,0 +1,106 @@
+/*
+ * FS.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef HOST_FS_H_
+#define HOST_FS_H_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Arduino.h>
+
+/// Host shim of SPIFFS: files in memory, that survive a simulated restart of the bulb.
+/* Like SPIFFS, "rename" fails onto an existing file. "bytesWritten" counts the flash wear.
+ * */
+class File
+{
+public:
+  typedef std::vector<uint8_t> Data;
+
+  File() : position(0) {}
+  File(const std::shared_ptr<Data>& xdata) : data(xdata), position(0) {}
+
+  explicit operator bool() const { return nullptr != data; }
+
+  size_t size() const { return data ? data->size() : 0; }
+
+  size_t read(uint8_t* buffer, size_t length)
+  {
+    if (!data) return 0;
+    size_t n = std::min(length, data->size() - position);
+    memcpy(buffer, data->data() + position, n);
+    position += n;
+    return n;
+  }
+
+  size_t readBytes(char* buffer, size_t length) { return read(reinterpret_cast<uint8_t*>(buffer), length); }
+
+  size_t write(const uint8_t* buffer, size_t length);
+
+  void close() { data.reset(); }
+
+private:
+  std::shared_ptr<Data> data;
+  size_t position;
+};
+
+class FS
+{
+public:
+  bool begin() { return true; }
+
+  bool exists(const char* path) const
+  {
+    Host::HeapScope host(false); // the key is a temporary string
+    return files.count(path) > 0;
+  }
+
+  File open(const char* path, const char* mode)
+  {
+    Host::HeapScope host(false);
+    if ('w' == mode[0])
+    {
+      files[path] = std::make_shared<File::Data>();
+    }
+    std::map<std::string, std::shared_ptr<File::Data>>::iterator it = files.find(path);
+    return files.end() == it ? File() : File(it->second);
+  }
+
+  bool remove(const char* path)
+  {
+    Host::HeapScope host(false);
+    return files.erase(path) > 0;
+  }
+
+  bool rename(const char* from, const char* to)
+  {
+    Host::HeapScope host(false);
+    if (!exists(from) || exists(to)) return false;
+    files[to] = files[from];
+    files.erase(from);
+    return true;
+  }
+
+  unsigned long bytesWritten = 0;
+
+private:
+  std::map<std::string, std::shared_ptr<File::Data>> files;
+};
+
+extern FS SPIFFS;
+
+inline size_t File::write(const uint8_t* buffer, size_t length)
+{
+  Host::HeapScope host(false);
+  if (!data) return 0;
+  data->insert(data->end(), buffer, buffer + length);
+  SPIFFS.bytesWritten += length;
+  return length;
+}
+
+#endif /* HOST_FS_H_ */
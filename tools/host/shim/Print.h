@@ -0,0 +1,83 @@
+/*
+ * Print.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef HOST_PRINT_H_
+#define HOST_PRINT_H_
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/// a string in flash, on the host it is an ordinary "const char*"
+class __FlashStringHelper;
+
+#define DEC 10
+#define HEX 16
+
+/// Host shim of the "Print" class of the Arduino core.
+class Print
+{
+public:
+  virtual ~Print() {}
+
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size)
+  {
+    size_t n = 0;
+    while (size-- && 1 == write(*buffer++)) n++;
+    return n;
+  }
+  size_t write(const char* text) { return text ? write(reinterpret_cast<const uint8_t*>(text), strlen(text)) : 0; }
+  size_t write(const char* buffer, size_t size) { return write(reinterpret_cast<const uint8_t*>(buffer), size); }
+
+  size_t print(const __FlashStringHelper* text) { return write(reinterpret_cast<const char*>(text)); }
+  size_t print(const char* text) { return write(text); }
+  size_t print(char c) { return write(uint8_t(c)); }
+  size_t print(unsigned char value, int base = DEC) { return print((unsigned long) value, base); }
+  size_t print(int value, int base = DEC) { return print((long) value, base); }
+  size_t print(unsigned int value, int base = DEC) { return print((unsigned long) value, base); }
+  size_t print(long value, int base = DEC) { return DEC == base ? printf("%ld", value) : print((unsigned long) value, base); }
+  size_t print(unsigned long value, int base = DEC) { return printf(HEX == base ? "%lX" : "%lu", value); }
+  size_t print(long long value) { return printf("%lld", value); }
+  size_t print(unsigned long long value) { return printf("%llu", value); }
+  size_t print(double value, int digits = 2) { return printf("%.*f", digits, value); }
+
+  template <typename T>
+  size_t println(T value) { size_t n = print(value); return n + println(); }
+  template <typename T>
+  size_t println(T value, int format) { size_t n = print(value, format); return n + println(); }
+  size_t println() { return write("\r\n"); }
+
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)))
+  {
+    va_list args;
+    va_start(args, format);
+    size_t n = vprint(format, args);
+    va_end(args);
+    return n;
+  }
+
+  size_t printf_P(const char* format, ...) __attribute__((format(printf, 2, 3)))
+  {
+    va_list args;
+    va_start(args, format);
+    size_t n = vprint(format, args);
+    va_end(args);
+    return n;
+  }
+
+private:
+  size_t vprint(const char* format, va_list args)
+  {
+    char buffer[256];
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    if (length < 0) return 0;
+    return write(buffer, size_t(length) < sizeof(buffer) ? size_t(length) : sizeof(buffer) - 1);
+  }
+};
+
+#endif /* HOST_PRINT_H_ */
@@ -0,0 +1,230 @@
+/*
+ * PubSubClient.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef HOST_PUBSUBCLIENT_H_
+#define HOST_PUBSUBCLIENT_H_
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+
+#define MQTT_MAX_PACKET_SIZE 256
+
+namespace Host
+{
+/// In-process stand-in for the broker and the network between the bulb and a controller.
+/* The controller (the soak driver) publishes with "publish", the bulb gets the message "latency_us" later,
+ * if it has subscribed the topic, like with a clean session. Messages of the bulb go to the "observer".
+ * "stop" drops the connection and refuses connects until "start", messages published meanwhile are lost.
+ * */
+class Broker
+{
+public:
+  typedef std::function<void(const std::string& topic, const std::string& payload, bool retained)> F_Observer;
+
+  static Broker& instance()
+  {
+    static Broker broker;
+    return broker;
+  }
+
+  // ---- controller side
+
+  void publish(const std::string& topic, const std::string& payload)
+  {
+    HeapScope host(false);
+    published++;
+    if (!up || !clientConnected || 0 == subscriptions.count(topic))
+    {
+      lost++;
+      return;
+    }
+    Message message = {now_us() + latency_us, topic, payload};
+    inbound.push_back(message);
+  }
+
+  void setObserver(const F_Observer& xobserver) { observer = xobserver; }
+
+  void stop()
+  {
+    up = false;
+    dropConnection();
+  }
+
+  void start() { up = true; }
+
+  bool isUp() const { return up; }
+  bool isClientConnected() const { return clientConnected; }
+
+  /// messages of the controller, that the bulb hasn't read yet
+  size_t waiting() const { return inbound.size(); }
+
+  uint64_t latency_us = 5000;
+  unsigned long published = 0;       // by the controller
+  unsigned long lost = 0;            // of them, not delivered
+  unsigned long connects = 0;
+  unsigned long received = 0;        // from the bulb
+  unsigned long protocolErrors = 0;  // streamed messages, that didn't have the announced length
+
+  // ---- bulb side, used by "PubSubClient"
+
+  bool connect()
+  {
+    if (!up) return false;
+    clientConnected = true;
+    connects++;
+    return true;
+  }
+
+  void dropConnection()
+  {
+    HeapScope host(false);
+    clientConnected = false;
+    subscriptions.clear();
+    lost += inbound.size();
+    inbound.clear();
+  }
+
+  void subscribe(const char* topic)
+  {
+    HeapScope host(false);
+    subscriptions.insert(topic);
+  }
+
+  void receive(const std::string& topic, const std::string& payload, bool retained)
+  {
+    HeapScope host(false);
+    received++;
+    if (retained) this->retained[topic] = payload;
+    if (observer) observer(topic, payload, retained);
+  }
+
+  /// the next message, that has arrived at the bulb
+  bool next(std::string& topic, std::string& payload)
+  {
+    HeapScope host(false);
+    if (inbound.empty() || inbound.front().deliverAt > now_us()) return false;
+    topic = inbound.front().topic;
+    payload = inbound.front().payload;
+    inbound.pop_front();
+    return true;
+  }
+
+private:
+  struct Message
+  {
+    uint64_t deliverAt;
+    std::string topic;
+    std::string payload;
+  };
+
+  bool up = true;
+  bool clientConnected = false;
+  std::set<std::string> subscriptions;
+  std::map<std::string, std::string> retained;
+  std::deque<Message> inbound;
+  F_Observer observer;
+};
+}
+
+/// Host shim of "PubSubClient", connected to "Host::Broker".
+/* Like the library, "loop" handles at most one inbound message per call and "publish" fails
+ * for packets larger than "MQTT_MAX_PACKET_SIZE".
+ * */
+class PubSubClient : public Print
+{
+public:
+  typedef std::function<void(char*, uint8_t*, unsigned int)> F_Callback;
+
+  explicit PubSubClient(Client&) {}
+
+  PubSubClient& setServer(const char*, uint16_t) { return *this; }
+  PubSubClient& setCallback(const F_Callback& xcallback) { callback = xcallback; return *this; }
+
+  bool connect(const char*) { return Host::Broker::instance().connect(); }
+  void disconnect() { Host::Broker::instance().dropConnection(); }
+  bool connected() { return Host::Broker::instance().isClientConnected(); }
+  bool subscribe(const char* topic)
+  {
+    if (!connected()) return false;
+    Host::Broker::instance().subscribe(topic);
+    return true;
+  }
+
+  bool loop()
+  {
+    if (!connected()) return false;
+    std::string topic;
+    std::string payload;
+    if (Host::Broker::instance().next(topic, payload) && callback)
+    {
+      callback(&topic[0], reinterpret_cast<uint8_t*>(&payload[0]), payload.size());
+    }
+    return true;
+  }
+
+  bool publish(const char* topic, const char* payload, bool retained = false)
+  {
+    Host::HeapScope host(false);
+    if (!connected() || 7 + strlen(topic) + strlen(payload) > MQTT_MAX_PACKET_SIZE) return false;
+    Host::Broker::instance().receive(topic, payload, retained);
+    return true;
+  }
+
+  bool beginPublish(const char* topic, unsigned int length, bool retained)
+  {
+    Host::HeapScope host(false);
+    if (!connected()) return false;
+    streamTopic = topic;
+    streamLength = length;
+    streamRetained = retained;
+    streamPayload.clear();
+    return true;
+  }
+
+  virtual size_t write(uint8_t c)
+  {
+    Host::HeapScope host(false);
+    streamPayload += char(c);
+    return 1;
+  }
+
+  virtual size_t write(const uint8_t* buffer, size_t size)
+  {
+    Host::HeapScope host(false);
+    streamPayload.append(reinterpret_cast<const char*>(buffer), size);
+    return size;
+  }
+
+  using Print::write;
+
+  int endPublish()
+  {
+    Host::Broker& broker = Host::Broker::instance();
+    if (streamPayload.size() != streamLength)
+    {
+      broker.protocolErrors++; // the broker would read the next packet from the wrong position
+      broker.dropConnection();
+      return 0;
+    }
+    broker.receive(streamTopic, streamPayload, streamRetained);
+    return 1;
+  }
+
+private:
+  F_Callback callback;
+  std::string streamTopic;
+  std::string streamPayload;
+  size_t streamLength = 0;
+  bool streamRetained = false;
+};
+
+#endif /* HOST_PUBSUBCLIENT_H_ */
@@ -0,0 +1,19 @@
+/*
+ * WiFiClient.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef HOST_WIFICLIENT_H_
+#define HOST_WIFICLIENT_H_
+
+/// Host shim, the connection is simulated by "Host::Broker", see "PubSubClient.h".
+class Client
+{
+};
+
+class WiFiClient : public Client
+{
+};
+
+#endif /* HOST_WIFICLIENT_H_ */
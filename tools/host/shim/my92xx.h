@@ -0,0 +1,31 @@
+/*
+ * my92xx.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef HOST_MY92XX_H_
+#define HOST_MY92XX_H_
+
+/// Host shim of the my92xx library, only the declarations, that "LightDrivers.h" needs.
+/* The soak driver uses its own recording driver, "My92xxDriver" only has to compile.
+ * */
+typedef enum {MY92XX_MODEL_MY9291 = 0x00, MY92XX_MODEL_MY9231 = 0x01} my92xx_model_t;
+
+typedef struct
+{
+  int value;
+} my92xx_cmd_t;
+
+#define MY92XX_COMMAND_DEFAULT {0}
+
+class my92xx
+{
+public:
+  my92xx(my92xx_model_t, unsigned char, unsigned char, unsigned char, my92xx_cmd_t) {}
+  void setState(bool) {}
+  void setChannel(unsigned char, unsigned int) {}
+  void update() {}
+};
+
+#endif /* HOST_MY92XX_H_ */
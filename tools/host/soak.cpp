@@ -0,0 +1,558 @@
+/*
+ * soak.cpp
+ *
+ *  Created on: 19.10.2026
+ */
+
+/// In-process soak test: the MQTT, command, light output, sunrise, alarm and config logic on the host shim.
+/*   make -C tools/host && tools/host/soak --days 7
+ *   tools/host/soak --days 1 --pattern burst --pattern toggle --replay traffic.txt
+ *
+ * "Bulb" sets up the firmware classes and "LightControl" like "sonoff_b1.ino" (without WiFi, web server,
+ * OTA and streaming), the led driver only records the frames. A controller publishes on "Host::Broker" one pattern every
+ * "--interval" seconds, like "tools/mqtt_soak.py" does with a real bulb and broker:
+ *   burst    "--burst" brightness commands back to back on <device>/set
+ *   slider   brightness commands at 50 Hz for 3 seconds, like a slider in a dashboard
+ *   toggle   "--burst" toggles on <device>/control, the power must be flipped as often
+ *   restart  the broker is down for "--down" seconds, measures the time until the bulb is back
+ *   reboot   restarts the bulb (the config is flushed like before "ESP.restart"), the state must survive
+ *   replay   lines "<seconds> <topic> <payload>" of "--replay", the topic without "<device>/"
+ * The alarm "* 06:30 sunrise 1800" runs on every simulated day.
+ *
+ * The simulated clock moves 1 ms per loop, like "run_loop(1, 1)" of the firmware, and 100 ms while no
+ * message, command or transition is waiting, so a day takes seconds. Latency is simulated time from a
+ * command to the retained state with its brightness. The heap is the one of the firmware classes.
+ * The exit code is 1, if commands were dropped, a toggle was lost, an alarm didn't run, the state didn't
+ * survive a reboot, a streamed message had the wrong length or the heap grew by more than "--max-leak" bytes.
+ * */
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "LightControl.h"
+#include "LightDrivers.h"
+#include "LightOutput.h"
+#include "LightState.h"
+#include "Sunrise.h"
+#include "Transition.h"
+#include "myiot_stallWatchdog.h"
+
+namespace
+{
+typedef MyIOT::TimerSystem::TimeSpec TimeSpec;
+
+const uint64_t MS = 1000;
+const uint64_t SECOND = 1000 * MS;
+const uint64_t LATENCY_TIMEOUT = 5 * SECOND;
+const char* const DEVICE = "bulb";
+const char* const ALARM = "0 * 06:30 sunrise 1800";
+
+/// keeps the frames instead of sending them to led drivers
+class RecordingDriver
+{
+public:
+  void setup() {}
+  void setChannel(unsigned char channel, unsigned int value)
+  {
+    if (channel < LightFrame::NUMBER_OF_VALUES) values[channel] = value;
+  }
+  void update() { updates++; }
+
+  unsigned int values[LightFrame::NUMBER_OF_VALUES] = {0};
+  unsigned long updates = 0;
+};
+
+typedef LightOutput<RecordingDriver, ChannelMap<0, 1, 2, 3, 4>> Light;
+
+/// The firmware without WiFi, web server, OTA and streaming, set up like "sonoff_b1.ino".
+class Bulb
+{
+public:
+  Bulb() : lightControl(light, lightState, transition, sunrise, store, mqtt, wallClock, alarms, watchdog)
+  {
+  }
+
+  void setup()
+  {
+    watchdog.setup();
+    tsystem.set_observer(&watchdog);
+
+    light.setup();
+    bool restored = light.restoreFrame(); // RTC memory, before the file system is mounted
+    store.setup();
+    MyIOT::ConfigRecord& record = store.get();
+    if (0 == record.deviceName[0]) // first boot, the web UI of the firmware would set these
+    {
+      MyIOT::ConfigStore::setString(record.deviceName, DEVICE, sizeof(record.deviceName));
+      MyIOT::ConfigStore::setString(record.mqttServer, "broker", sizeof(record.mqttServer));
+      MyIOT::ConfigStore::setString(record.timezone, "CET-1CEST,M3.5.0,M10.5.0/3", sizeof(record.timezone));
+      store.save();
+    }
+    lightState.setup(record);
+    if (!restored) // power cycle
+    {
+      lightControl.restoreLightState();
+      light.flush();
+    }
+    tsystem.add_first(&light, TimeSpec(0, 5e6), "output");
+
+    wallClock.setup(record.timezone);
+    alarms.setup(tsystem, wallClock, record.alarms);
+    lightControl.setup(tsystem);
+    tsystem.add(&store, TimeSpec(1, 0), "config");
+
+    // "startNetworkServices" of the firmware
+    mqtt.setup(record.deviceName, record.mqttServer);
+    mqtt.setGroup(record.group);
+    tsystem.add(&mqtt, TimeSpec(0, 100e6), "mqtt");
+    tsystem.add([this](){ publishMetrics(); }, TimeSpec(60, 0), "metrics");
+  }
+
+  /// one iteration of "loop", then the clock moves "tickMs" forward
+  void loop(int tickMs)
+  {
+    tsystem.run_loop(tickMs, 1);
+  }
+
+  /// "ESP.restart" flushes the config first, see "OTA::setOnRestart"
+  void flush()
+  {
+    store.flush();
+  }
+
+  /// a message, command, start time or fade is waiting, the clock has to move in steps of 1 ms
+  bool isBusy() const { return lightControl.isBusy(); }
+
+  const LightState& getLightState() const { return lightState; }
+  const Light& getLight() const { return light; }
+  const MyIOT::CommandStage& getCommands() const { return lightControl.getCommands(); }
+  const MyIOT::ConfigStore& getStore() const { return store; }
+  const MyIOT::AlarmScheduler& getAlarms() const { return alarms; }
+
+private:
+  void publishMetrics()
+  {
+    if (!mqtt.isConnected()) return;
+    MyIOT::HeapSnapshot heap; // the same values in both passes of "publish"
+    mqtt.publish("metrics", [this, &heap](Print& out){
+      MyIOT::MetricsWriter metrics(out);
+      metrics.heap(heap);
+      metrics.timerSystem(tsystem);
+      lightControl.printMetrics(metrics);
+    });
+  }
+
+  MyIOT::Mqtt mqtt;
+  MyIOT::ConfigStore store;
+  MyIOT::Clock wallClock;
+  MyIOT::AlarmScheduler alarms;
+  MyIOT::StallWatchdog watchdog;
+  Sunrise sunrise;
+  Light light;
+  Transition transition;
+  LightState lightState;
+  LightControl lightControl;
+  MyIOT::TimerSystem tsystem; // the last member, it is destroyed first and calls "destroy" of the others
+};
+
+struct Options
+{
+  double days = 1;
+  std::vector<std::string> patterns;
+  std::string replay;
+  int burst = 20;
+  double down = 5;
+  double interval = 10;
+  double report = 24 * 3600;
+  long maxLeak = 0;
+  bool verbose = false;
+};
+
+double percentile(std::vector<double> values, double p)
+{
+  if (values.empty()) return 0;
+  std::sort(values.begin(), values.end());
+  return values[std::min(values.size() - 1, size_t(p / 100 * values.size()))];
+}
+
+/// the number after "key" in a JSON text, -1 if there is none
+long jsonNumber(const std::string& text, const char* key)
+{
+  size_t pos = text.find(key);
+  return std::string::npos == pos ? -1 : atol(text.c_str() + pos + strlen(key));
+}
+
+/// The controller: publishes the patterns, checks the answers and restarts broker and bulb.
+class Controller
+{
+public:
+  explicit Controller(const Options& xoptions) : options(xoptions), broker(Host::Broker::instance())
+  {
+    broker.setObserver([this](const std::string& topic, const std::string& payload, bool){
+      if (topic == std::string(DEVICE) + "/state") onState(payload);
+    });
+  }
+
+  int run()
+  {
+    std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+    boot();
+    heapBaseline = Host::heap_used(); // nothing is allocated after "setup"
+    at(SECOND, [this](){ publish("alarm", ALARM); alarmSetAt = Host::now_us(); });
+
+    uint64_t end = uint64_t(options.days * 24 * 3600 * SECOND);
+    uint64_t nextPattern = 2 * SECOND;
+    uint64_t nextReport = uint64_t(options.report * SECOND);
+    size_t round = 0;
+    while (Host::now_us() < end)
+    {
+      if (Host::now_us() >= nextPattern)
+      {
+        startPattern(options.patterns[round++ % options.patterns.size()]);
+        nextPattern += uint64_t(options.interval * SECOND);
+      }
+      runEvents();
+      if (Host::now_us() >= nextReport)
+      {
+        report();
+        nextReport += uint64_t(options.report * SECOND);
+      }
+
+      uint64_t untilEvent = std::min(nextPattern, events.empty() ? nextPattern : events.begin()->first) - Host::now_us();
+      bool busy = bulb->isBusy() || broker.waiting() > 0;
+      int tickMs = busy ? 1 : int(std::max<uint64_t>(1, std::min<uint64_t>(100, untilEvent / MS)));
+      {
+        Host::HeapScope firmware(true);
+        bulb->loop(tickMs);
+      }
+    }
+    // the commands, that are still in flight, get up to a minute, before the last checks
+    for (uint64_t drainEnd = Host::now_us() + 60 * SECOND;
+         (bulb->isBusy() || broker.waiting() > 0) && Host::now_us() < drainEnd;)
+    {
+      Host::HeapScope firmware(true);
+      bulb->loop(1);
+    }
+    checkToggles();
+    expirePending(~0ull);
+    report();
+
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    long leak = long(Host::heap_used()) - long(heapBaseline);
+    unsigned long expectedAlarms = countAlarms(alarmSetAt, end);
+    printf("simulated %.1f days in %.1f s\n", options.days, wallSeconds);
+
+    int ret = 0;
+    Totals total = totals;
+    total.add(*bulb);
+    ret |= check(0 == total.dropped, "commands dropped");
+    ret |= check(0 == toggleErrors, "toggles lost");
+    ret |= check(total.alarms >= expectedAlarms, "alarms missed");
+    ret |= check(0 == rebootErrors, "state lost at a reboot");
+    ret |= check(0 == broker.protocolErrors, "streamed messages with a wrong length");
+    ret |= check(leak <= options.maxLeak, "heap grows");
+    return ret;
+  }
+
+private:
+  void boot()
+  {
+    bulb.reset(new Bulb());
+    Host::HeapScope firmware(true);
+    bulb->setup();
+  }
+
+  /// like "ESP.restart": the config is flushed, RTC memory and SPIFFS are kept, the TCP connection is gone
+  void reboot()
+  {
+    const LightState& state = bulb->getLightState();
+    bool power = state.getPower();
+    uint8_t brightness = state.getBrightness();
+    LightState::ColorMode mode = state.getColorMode();
+    uint16_t colorTemp = state.getColorTemp();
+    std::vector<unsigned int> frame(bulb->getLight().getFrame(), bulb->getLight().getFrame() + Light::NUMBER_OF_VALUES);
+    {
+      Host::HeapScope firmware(true);
+      bulb->flush();
+      totals.add(*bulb);
+      bulb.reset();
+    }
+    broker.dropConnection();
+    boot();
+    reboots++;
+    const LightState& restored = bulb->getLightState();
+    bool same = power == restored.getPower() && brightness == restored.getBrightness()
+        && mode == restored.getColorMode() && colorTemp == restored.getColorTemp()
+        && std::equal(frame.begin(), frame.end(), bulb->getLight().getFrame());
+    if (!same) rebootErrors++;
+  }
+
+  void startPattern(const std::string& name)
+  {
+    checkToggles();
+    uint64_t now = Host::now_us();
+    if ("burst" == name)
+    {
+      for (int i = 0; i < options.burst; i++) setBrightness();
+    }
+    else if ("slider" == name)
+    {
+      for (int i = 0; i < 150; i++) at(now + i * 20 * MS, [this](){ setBrightness(); });
+    }
+    else if ("toggle" == name)
+    {
+      expectedPower = bulb->getLightState().getPower() != (options.burst % 2 == 1);
+      toggling = true;
+      for (int i = 0; i < options.burst; i++) publish("control", "toggle");
+    }
+    else if ("restart" == name)
+    {
+      broker.stop();
+      at(now + uint64_t(options.down * SECOND), [this](){
+        broker.start();
+        restartedAt = Host::now_us();
+      });
+    }
+    else if ("reboot" == name)
+    {
+      reboot();
+    }
+    else if ("replay" == name)
+    {
+      std::ifstream lines(options.replay);
+      std::string line;
+      while (std::getline(lines, line))
+      {
+        std::istringstream fields(line);
+        double seconds = 0;
+        std::string topic;
+        std::string payload;
+        if ('#' == line[0] || !(fields >> seconds >> topic) || !std::getline(fields >> std::ws, payload)) continue;
+        at(now + uint64_t(seconds * SECOND), [this, topic, payload](){ publish(topic, payload); });
+      }
+    }
+  }
+
+  /// the power after a toggle pattern
+  void checkToggles()
+  {
+    if (!toggling) return;
+    toggling = false;
+    if (bulb->getLightState().getPower() != expectedPower) toggleErrors++;
+  }
+
+  void setBrightness()
+  {
+    brightness = brightness % 254 + 1; // every command is a change
+    pending.push_back(std::make_pair(brightness, Host::now_us()));
+    sent++;
+    expirePending(Host::now_us());
+    publish("set", "{\"brightness\": " + std::to_string(brightness) + "}");
+  }
+
+  void publish(const std::string& topic, const std::string& payload)
+  {
+    broker.publish(std::string(DEVICE) + "/" + topic, payload);
+  }
+
+  void onState(const std::string& payload)
+  {
+    bool sunrise = std::string::npos != payload.find("\"effect\":\"sunrise\"");
+    if (sunrise && !inSunrise) sunrises++;
+    inSunrise = sunrise;
+    if (restartedAt)
+    {
+      reconnectMax = std::max(reconnectMax, Host::now_us() - restartedAt);
+      restartedAt = 0;
+    }
+
+    long value = jsonNumber(payload, "\"brightness\":");
+    for (size_t i = 0; i < pending.size(); i++)
+    {
+      if (pending[i].first == value)
+      {
+        latencies.push_back((Host::now_us() - pending[i].second) / double(MS));
+        coalesced += i; // the older ones were replaced by this one
+        pending.erase(pending.begin(), pending.begin() + i + 1);
+        break;
+      }
+    }
+  }
+
+  void expirePending(uint64_t now)
+  {
+    while (!pending.empty() && (now == ~0ull || pending.front().second + LATENCY_TIMEOUT < now))
+    {
+      pending.pop_front();
+      lost++;
+    }
+  }
+
+  void at(uint64_t time, const std::function<void()>& action)
+  {
+    events.insert(std::make_pair(time, action));
+  }
+
+  void runEvents()
+  {
+    while (!events.empty() && events.begin()->first <= Host::now_us())
+    {
+      std::function<void()> action = events.begin()->second;
+      events.erase(events.begin());
+      action();
+    }
+  }
+
+  /// alarms at 06:30 local time between "from" and "to" (simulated time)
+  static unsigned long countAlarms(uint64_t from, uint64_t to)
+  {
+    unsigned long ret = 0;
+    time_t start = Host::START_EPOCH;
+    for (int day = 0; day <= int(to / (24 * 3600 * SECOND)) + 1; day++)
+    {
+      tm local;
+      localtime_r(&start, &local);
+      local.tm_mday += day;
+      local.tm_hour = 6;
+      local.tm_min = 30;
+      local.tm_sec = 0;
+      local.tm_isdst = -1;
+      uint64_t alarm = uint64_t(mktime(&local) - start) * SECOND;
+      if (from < alarm && alarm < to) ret++;
+    }
+    return ret;
+  }
+
+  void report()
+  {
+    expirePending(Host::now_us());
+    Totals total = totals;
+    total.add(*bulb);
+    printf("%6.2f h  sent %lu  answered %zu  coalesced %lu  lost %lu  latency ms p50 %.0f p90 %.0f p99 %.0f max %.0f\n",
+           Host::now_us() / double(3600 * SECOND), sent, latencies.size(), coalesced, lost,
+           percentile(latencies, 50), percentile(latencies, 90), percentile(latencies, 99),
+           latencies.empty() ? 0 : *std::max_element(latencies.begin(), latencies.end()));
+    printf("          bulb: commands %lu  coalesced %lu  dropped %lu  heap %zu bytes in %zu blocks (peak %zu)"
+           "  config writes %lu (%lu bytes)  led updates %lu\n",
+           total.commands, total.coalesced, total.dropped, Host::heap_used(), Host::heap_blocks(), Host::heap_peak(),
+           total.configWrites, SPIFFS.bytesWritten, total.ledUpdates);
+    printf("          alarms %lu  sunrises published %lu  toggle errors %lu  reboots %lu (%lu failed)  broker connects %lu"
+           "  reconnect max %.0f ms  broker lost %lu  protocol errors %lu\n",
+           total.alarms, sunrises, toggleErrors, reboots, rebootErrors, broker.connects, reconnectMax / double(MS),
+           broker.lost, broker.protocolErrors);
+  }
+
+  static int check(bool ok, const char* what)
+  {
+    if (!ok) printf("FAILED: %s\n", what);
+    return ok ? 0 : 1;
+  }
+
+  /// the counters of the bulb, they start again after a reboot
+  struct Totals
+  {
+    void add(const Bulb& bulb)
+    {
+      commands += bulb.getCommands().getSubmitted();
+      coalesced += bulb.getCommands().getCoalesced();
+      dropped += bulb.getCommands().getDropped();
+      configWrites += bulb.getStore().getWrites();
+      ledUpdates += bulb.getLight().getUpdates();
+      alarms += bulb.getAlarms().getRuns();
+    }
+    unsigned long commands = 0;
+    unsigned long coalesced = 0;
+    unsigned long dropped = 0;
+    unsigned long configWrites = 0;
+    unsigned long ledUpdates = 0;
+    unsigned long alarms = 0;
+  };
+
+  const Options& options;
+  Host::Broker& broker;
+  Totals totals;
+  std::unique_ptr<Bulb> bulb;
+  std::multimap<uint64_t, std::function<void()>> events;
+
+  std::deque<std::pair<long, uint64_t>> pending; // (brightness, sent at)
+  std::vector<double> latencies;
+  long brightness = 0;
+  unsigned long sent = 0;
+  unsigned long coalesced = 0;
+  unsigned long lost = 0;
+
+  bool toggling = false;
+  bool expectedPower = false;
+  unsigned long toggleErrors = 0;
+
+  bool inSunrise = false;
+  unsigned long sunrises = 0;
+  uint64_t alarmSetAt = 0;
+
+  uint64_t restartedAt = 0;
+  uint64_t reconnectMax = 0;
+  unsigned long reboots = 0;
+  unsigned long rebootErrors = 0;
+
+  size_t heapBaseline = 0;
+};
+
+void usage()
+{
+  fprintf(stderr, "usage: soak [--days 1] [--pattern burst|slider|toggle|restart|reboot|replay ...] [--replay file]\n"
+                  "            [--burst 20] [--down 5] [--interval 10] [--report seconds] [--max-leak 0] [--verbose]\n");
+}
+}
+
+int main(int argc, char** argv)
+{
+  Options options;
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if ("--verbose" == arg)
+    {
+      options.verbose = true;
+      continue;
+    }
+    if (!value)
+    {
+      usage();
+      return 2;
+    }
+    i++;
+    if ("--days" == arg) options.days = atof(value);
+    else if ("--pattern" == arg) options.patterns.push_back(value);
+    else if ("--replay" == arg) options.replay = value;
+    else if ("--burst" == arg) options.burst = atoi(value);
+    else if ("--down" == arg) options.down = atof(value);
+    else if ("--interval" == arg) options.interval = atof(value);
+    else if ("--report" == arg) options.report = atof(value);
+    else if ("--max-leak" == arg) options.maxLeak = atol(value);
+    else
+    {
+      usage();
+      return 2;
+    }
+  }
+  if (options.patterns.empty())
+  {
+    options.patterns = {"burst", "slider", "toggle", "restart", "reboot"};
+  }
+  if (!options.replay.empty() && options.patterns.end() == std::find(options.patterns.begin(), options.patterns.end(), "replay"))
+  {
+    options.patterns.push_back("replay");
+  }
+  Host::set_serial(options.verbose);
+
+  Controller controller(options);
+  return controller.run();
+}
@@ -0,0 +1,258 @@
+/*
+ * tests.cpp
+ *
+ *  Created on: 19.10.2026
+ */
+
+/// Host tests of the firmware classes for cases, that the soak test doesn't reach by chance.
+/*   make -C tools/host test
+ *
+ * Every test prints "FAILED: <what>" for a failed check, the exit code is 1, if any check failed.
+ * */
+
+#include <string>
+#include <vector>
+
+#include "LightCommands.h"
+#include "LightControl.h"
+#include "LightDrivers.h"
+#include "LightOutput.h"
+#include "LightState.h"
+#include "myiot_ConfigStore.h"
+#include "myiot_alarmScheduler.h"
+#include "myiot_clock.h"
+#include "myiot_commandStage.h"
+
+namespace
+{
+int failures = 0;
+
+void check(bool ok, const char* what)
+{
+  if (ok) return;
+  printf("FAILED: %s\n", what);
+  failures++;
+}
+
+/// "set", "control" OFF, "set" must be applied in this order, the light ends ON
+/* Merging the second "set" into the first one would jump over the OFF, the light would end OFF.
+ * */
+void testCommandOrder()
+{
+  enum {CMD_CONTROL, CMD_SET};
+  MyIOT::ConfigRecord record = MyIOT::ConfigRecord();
+  LightState lightState;
+  lightState.setup(record);
+  std::vector<std::string> applied;
+
+  MyIOT::CommandStage commands;
+  commands.setup(CMD_CONTROL, [&](const char* message){
+    applied.push_back(message);
+    lightState.setPower(0 == strcasecmp("ON", message));
+  }, 10, 5, LightCommands::mergeControl);
+  commands.setup(CMD_SET, [&](const char* message){
+    applied.push_back(message);
+    char buffer[LightState::MAX_COMMAND_LENGTH];
+    MyIOT::ConfigStore::setString(buffer, message, sizeof(buffer));
+    StaticJsonBuffer<LightState::JSON_CAPACITY> jsonBuffer;
+    uint32_t transitionMs = 0;
+    lightState.apply(jsonBuffer.parseObject(buffer), transitionMs);
+  }, 10, 5, LightState::merge);
+
+  commands.submit(CMD_SET, "{\"brightness\": 100}");
+  commands.submit(CMD_CONTROL, "OFF");
+  commands.submit(CMD_SET, "{\"brightness\": 120}");
+  check(0 == commands.getCoalesced(), "command order: a set was merged over a control command");
+  for (int i = 0; i < 3; i++)
+  {
+    commands.expire();
+    delay(20);
+  }
+
+  check(3 == applied.size() && "OFF" == applied[1], "command order: not applied in the order of arrival");
+  check(lightState.getPower(), "command order: the light is off");
+  check(120 == lightState.getBrightness(), "command order: wrong brightness");
+}
+
+/// the oldest command waits for the rate limit of its target, the commands after it wait too
+void testRateLimitKeepsOrder()
+{
+  enum {CMD_CONTROL, CMD_SUNRISE};
+  std::string applied;
+  MyIOT::CommandStage commands;
+  commands.setup(CMD_CONTROL, [&](const char* message){ applied += message; }, 10, 5);
+  commands.setup(CMD_SUNRISE, [&](const char* message){ applied += message; }, 1, 1);
+
+  commands.submit(CMD_SUNRISE, "a");
+  commands.submit(CMD_SUNRISE, "b");
+  commands.submit(CMD_CONTROL, "c");
+  for (int i = 0; i < 10; i++)
+  {
+    commands.expire();
+    delay(20);
+  }
+  check("a" == applied, "rate limit: a command jumped over a waiting one");
+  delay(1000);
+  for (int i = 0; i < 10; i++)
+  {
+    commands.expire();
+    delay(20);
+  }
+  check("abc" == applied, "rate limit: not applied in the order of arrival");
+}
+
+/// the export of a record, that has all fields at their longest, is imported again unchanged
+/* Every character of the strings is escaped, so the JSON text has "ConfigStore::MAX_JSON_LENGTH",
+ * the size of the buffer of "POST /config.json".
+ * */
+void testImportMaximalExport()
+{
+  MyIOT::ConfigStore exported;
+  size_t count = 0;
+  const MyIOT::ConfigField* fields = MyIOT::ConfigStore::schema(count);
+  for (size_t i = 0; i < count; i++)
+  {
+    const MyIOT::ConfigField field = MyIOT::ConfigStore::readField(fields, i);
+    if (field.importOnly) continue;
+    uint8_t* target = reinterpret_cast<uint8_t*>(&exported.get()) + field.offset;
+    memset(target, MyIOT::ConfigField::STRING == field.type ? '"' : 0xff, field.size);
+    if (MyIOT::ConfigField::STRING == field.type) target[field.size - 1] = 0;
+    if (MyIOT::ConfigField::BOOL == field.type) *target = 1;
+  }
+
+  char text[MyIOT::ConfigStore::MAX_JSON_LENGTH + 1];
+  {
+    StaticJsonBuffer<MyIOT::ConfigStore::JSON_CAPACITY> jsonBuffer;
+    JsonObject& json = jsonBuffer.createObject();
+    exported.exportJson(json);
+    check(json.measureLength() <= MyIOT::ConfigStore::MAX_JSON_LENGTH, "import: the export is longer than the buffer");
+    json.printTo(text, sizeof(text));
+  }
+
+  MyIOT::ConfigStore imported;
+  StaticJsonBuffer<MyIOT::ConfigStore::JSON_CAPACITY> jsonBuffer;
+  JsonObject& json = jsonBuffer.parseObject(text);
+  check(json.success(), "import: invalid JSON");
+  imported.importJson(json);
+  check(0 == memcmp(&exported.get(), &imported.get(), sizeof(MyIOT::ConfigRecord)), "import: the record changed");
+}
+
+/// a record of another version is not read as if it had the current layout
+void testRejectOtherVersion()
+{
+  MyIOT::ConfigStore written;
+  MyIOT::ConfigStore::setString(written.get().deviceName, "bulb", sizeof(MyIOT::ConfigRecord::deviceName));
+  written.flush();
+
+  MyIOT::ConfigStore current;
+  current.setup();
+  check(0 == strcmp("bulb", current.get().deviceName), "version: the current version is not read");
+
+  // the header: magic, version, size, crc
+  File file = SPIFFS.open("/config.bin", "r");
+  std::vector<uint8_t> data(file.size());
+  file.read(data.data(), data.size());
+  file.close();
+  data[4]++;
+  file = SPIFFS.open("/config.bin", "w");
+  file.write(data.data(), data.size());
+  file.close();
+
+  MyIOT::ConfigStore other;
+  other.setup();
+  check(0 == other.get().deviceName[0], "version: a record of another version is read");
+  SPIFFS.remove("/config.bin");
+}
+
+/// an alarm, whose minute passed while the timers were paused, runs late
+void testAlarmAfterPause()
+{
+  const uint64_t monday = Host::START_EPOCH * 1000;
+  MyIOT::TimerSystem tsystem;
+  MyIOT::Clock wallClock;
+  wallClock.setTimezone("");
+  check(wallClock.setTime(monday + (6 * 60 + 28) * 60000), "alarm: the time is not set");
+  check(wallClock.setTime(monday + (6 * 60 + 29) * 60000), "alarm: a later time is not set");
+
+  MyIOT::AlarmScheduler::Alarms alarms = {};
+  MyIOT::ConfigStore::setString(alarms[0], "1 06:30 ON", MyIOT::AlarmScheduler::ALARM_LENGTH);
+  MyIOT::AlarmScheduler scheduler;
+  std::string commands;
+  scheduler.setOnAlarm([&](const char* command){ commands += command; });
+  scheduler.setup(tsystem, wallClock, alarms);
+  scheduler.expire();
+  delay(120000); // 06:31, the timer didn't run at 06:30
+  scheduler.expire();
+  check("ON" == commands, "alarm: a passed alarm didn't run");
+  scheduler.expire();
+  check("ON" == commands, "alarm: an alarm ran twice");
+}
+
+/// a frame, that changes one channel, returns only this channel
+void testFrameMask()
+{
+  MyIOT::ConfigRecord record = MyIOT::ConfigRecord();
+  LightState lightState;
+  lightState.setup(record);
+  unsigned int warm[] = {0, 255, 0, 0, 0};
+  unsigned int warmRed[] = {0, 255, 128, 0, 0};
+  check(LightState::ALL_CHANNELS == lightState.setFrame(warm), "frame: a new mode changes all channels");
+  check(LightState::CH_RED == lightState.setFrame(warmRed), "frame: wrong channels");
+  check(0 == lightState.setFrame(warmRed), "frame: the same frame changed channels");
+}
+
+/// drops the frames
+struct NoDriver
+{
+  void setup() {}
+  void setChannel(unsigned char, unsigned int) {}
+  void update() {}
+};
+
+/// two timed commands wait both and run at their start times, in this order
+void testTimedCommands()
+{
+  MyIOT::TimerSystem tsystem;
+  MyIOT::Clock wallClock;
+  MyIOT::ConfigStore store;
+  MyIOT::Mqtt mqtt;
+  MyIOT::AlarmScheduler alarms;
+  MyIOT::StallWatchdog watchdog;
+  LightOutput<NoDriver, ChannelMap<0, 1, 2, 3, 4>> light;
+  LightState lightState;
+  Transition transition;
+  Sunrise sunrise;
+  LightControl lightControl(light, lightState, transition, sunrise, store, mqtt, wallClock, alarms, watchdog);
+  lightState.setup(store.get());
+  alarms.setup(tsystem, wallClock, store.get().alarms);
+  lightControl.setup(tsystem);
+  lightState.setPower(true);
+
+  check(wallClock.isSynchronized(), "timed: the clock is not set");
+  uint64_t now = wallClock.now_ms();
+  char command[48];
+  snprintf(command, sizeof(command), "@%llu OFF", (unsigned long long)(now + 100));
+  lightControl.submit(LightControl::CMD_CONTROL, command);
+  snprintf(command, sizeof(command), "@%llu ON", (unsigned long long)(now + 200));
+  lightControl.submit(LightControl::CMD_CONTROL, command);
+
+  tsystem.run_loop(1, 150);
+  check(!lightState.getPower(), "timed: the first command didn't run");
+  tsystem.run_loop(1, 100);
+  check(lightState.getPower(), "timed: the second command didn't run");
+  check(!lightControl.isBusy(), "timed: a command is still waiting");
+}
+}
+
+int main()
+{
+  testCommandOrder();
+  testRateLimitKeepsOrder();
+  testImportMaximalExport();
+  testRejectOtherVersion();
+  testAlarmAfterPause();
+  testTimedCommands();
+  testFrameMask();
+  printf("%s\n", failures ? "FAILED" : "OK");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,262 @@
+#!/usr/bin/env python3
+"""Soak and load test of a bulb over MQTT: replays traffic patterns and reports latency, drops and heap.
+
+    mqtt_soak.py <device> [--broker localhost] [--hours 24] [--pattern burst --pattern slider ...]
+    mqtt_soak.py <device> --pattern restart --broker-cmd "mosquitto -p 1883"
+    mqtt_soak.py <device> --pattern replay --replay traffic.txt
+
+Patterns, repeated every "--interval" seconds until "--hours" are over:
+  burst    "--burst" brightness commands back to back on <device>/set
+  slider   brightness commands at 50 Hz for 3 seconds, like a slider in a dashboard
+  restart  stops and starts the broker ("--broker-cmd"), measures the time until the bulb is back
+  replay   lines "<seconds> <topic> <payload>" of a file, the topic without "<device>/"
+
+Every command changes the brightness, the bulb answers with its retained <device>/state,
+so the latency is measured from the command to the state with this brightness.
+Commands, that are replaced by a later one before their state arrives, were coalesced by the bulb.
+Dropped and coalesced commands and the heap come from <device>/metrics (published every minute).
+The exit code is 1, if commands were dropped or the free heap shrinks faster than "--max-leak".
+Needs paho-mqtt (pip install paho-mqtt).
+"""
+import argparse
+import json
+import shlex
+import subprocess
+import sys
+import threading
+import time
+
+import paho.mqtt.client as mqtt
+
+LATENCY_TIMEOUT_S = 5
+
+
+class Bulb:
+    """Sends commands and collects the answers of one bulb."""
+
+    def __init__(self, device, host, port):
+        self.device = device
+        self.lock = threading.Lock()
+        self.pending = []  # (brightness, sent at)
+        self.latencies = []
+        self.sent = 0
+        self.coalesced = 0
+        self.lost = 0
+        self.brightness = 0
+        self.last_state = 0.0
+        self.metrics = []  # (time, {name: value})
+        if hasattr(mqtt, "CallbackAPIVersion"):
+            self.client = mqtt.Client(mqtt.CallbackAPIVersion.VERSION1)
+        else:
+            self.client = mqtt.Client()
+        self.client.on_connect = self.on_connect
+        self.client.on_message = self.on_message
+        self.client.reconnect_delay_set(1, 5)
+        self.client.connect_async(host, port)
+        self.client.loop_start()
+
+    def on_connect(self, client, userdata, flags, rc):
+        client.subscribe(self.device + "/state")
+        client.subscribe(self.device + "/metrics")
+
+    def on_message(self, client, userdata, message):
+        now = time.monotonic()
+        if message.topic.endswith("/metrics"):
+            self.metrics.append((now, parse_metrics(message.payload.decode(errors="replace"))))
+            return
+        try:
+            brightness = json.loads(message.payload)["brightness"]
+        except (ValueError, KeyError):
+            return
+        with self.lock:
+            self.last_state = now
+            for i, (value, sent) in enumerate(self.pending):
+                if value == brightness:
+                    self.latencies.append(now - sent)
+                    self.coalesced += i  # the older ones were replaced by this one
+                    del self.pending[:i + 1]
+                    break
+
+    def set_brightness(self):
+        with self.lock:
+            self.brightness = self.brightness % 254 + 1  # every command is a change
+            self.pending.append((self.brightness, time.monotonic()))
+            self.sent += 1
+            self.expire_pending()
+        self.publish("set", json.dumps({"brightness": self.brightness}))
+
+    def publish(self, topic, payload):
+        self.client.publish(self.device + "/" + topic, payload)
+
+    def expire_pending(self):
+        limit = time.monotonic() - LATENCY_TIMEOUT_S
+        while self.pending and self.pending[0][1] < limit:
+            self.pending.pop(0)
+            self.lost += 1
+
+
+def parse_metrics(text):
+    values = {}
+    for line in text.splitlines():
+        if line.startswith("myiot_") and "{" not in line:
+            name, _, value = line.partition(" ")
+            try:
+                values[name[len("myiot_"):]] = float(value)
+            except ValueError:
+                pass
+    return values
+
+
+def percentile(values, p):
+    if not values:
+        return float("nan")
+    values = sorted(values)
+    return values[min(len(values) - 1, int(p / 100.0 * len(values)))]
+
+
+def slope_per_hour(samples):
+    """least squares slope of (seconds, value) in value per hour"""
+    if len(samples) < 2:
+        return 0.0
+    n = float(len(samples))
+    mean_t = sum(t for t, _ in samples) / n
+    mean_v = sum(v for _, v in samples) / n
+    var = sum((t - mean_t) ** 2 for t, _ in samples)
+    if var == 0:
+        return 0.0
+    return sum((t - mean_t) * (v - mean_v) for t, v in samples) / var * 3600
+
+
+class Broker:
+    """A local broker, that the "restart" pattern stops and starts."""
+
+    def __init__(self, command):
+        self.command = shlex.split(command) if command else None
+        self.process = None
+        self.start()
+
+    def start(self):
+        if self.command:
+            self.process = subprocess.Popen(self.command)
+
+    def restart(self, down_s):
+        if not self.process:
+            return
+        self.process.terminate()
+        self.process.wait()
+        time.sleep(down_s)
+        self.start()
+
+    def stop(self):
+        if self.process:
+            self.process.terminate()
+
+
+def burst(bulb, args, broker):
+    for _ in range(args.burst):
+        bulb.set_brightness()
+
+
+def slider(bulb, args, broker):
+    for _ in range(150):
+        bulb.set_brightness()
+        time.sleep(0.02)
+
+
+def restart(bulb, args, broker):
+    if not broker.process:
+        print("restart: needs --broker-cmd", file=sys.stderr)
+        return
+    started = time.monotonic()
+    broker.restart(args.down)
+    # the bulb publishes its state after every connect
+    while bulb.last_state < started + args.down and time.monotonic() - started < 120:
+        time.sleep(0.1)
+    print("restart: bulb back after %.1f s" % (time.monotonic() - started - args.down))
+
+
+def replay(bulb, args, broker):
+    if not args.replay:
+        print("replay: needs --replay", file=sys.stderr)
+        return
+    start = time.monotonic()
+    with open(args.replay) as lines:
+        for line in lines:
+            fields = line.rstrip("\n").split(" ", 2)
+            if len(fields) < 3 or line.startswith("#"):
+                continue
+            delay = start + float(fields[0]) - time.monotonic()
+            if delay > 0:
+                time.sleep(delay)
+            bulb.publish(fields[1], fields[2])
+
+
+PATTERNS = {"burst": burst, "slider": slider, "restart": restart, "replay": replay}
+
+
+def report(bulb, started):
+    with bulb.lock:
+        bulb.expire_pending()
+        latencies = [1000 * value for value in bulb.latencies]
+        line = "%6.2f h  sent %d  answered %d  coalesced %d  lost %d  latency ms p50 %.0f p90 %.0f p99 %.0f max %.0f" % (
+            (time.monotonic() - started) / 3600, bulb.sent, len(latencies), bulb.coalesced, bulb.lost,
+            percentile(latencies, 50), percentile(latencies, 90), percentile(latencies, 99),
+            max(latencies) if latencies else float("nan"))
+    print(line)
+    if len(bulb.metrics) < 1:
+        return 0, 0.0
+    first = bulb.metrics[0][1]
+    last = bulb.metrics[-1][1]
+    dropped = last.get("commands_dropped_total", 0) - first.get("commands_dropped_total", 0)
+    heap = [(t, m["heap_free_bytes"]) for t, m in bulb.metrics if "heap_free_bytes" in m]
+    leak = slope_per_hour(heap)
+    print("          bulb: coalesced %d  dropped %d  heap %d..%d (%+.0f bytes/h)  max block %d  fragmentation max %d%%" % (
+        last.get("commands_coalesced_total", 0) - first.get("commands_coalesced_total", 0), dropped,
+        min(v for _, v in heap) if heap else 0, heap[-1][1] if heap else 0, leak,
+        last.get("heap_max_block_bytes", 0),
+        max(m.get("heap_fragmentation_percent", 0) for _, m in bulb.metrics)))
+    return dropped, leak
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("device")
+    parser.add_argument("--broker", default="localhost")
+    parser.add_argument("--port", type=int, default=1883)
+    parser.add_argument("--broker-cmd", help="start a local broker, e.g. \"mosquitto -p 1883\"")
+    parser.add_argument("--pattern", action="append", choices=sorted(PATTERNS))
+    parser.add_argument("--replay", help="traffic file for the replay pattern")
+    parser.add_argument("--burst", type=int, default=20)
+    parser.add_argument("--down", type=float, default=5, help="seconds the broker is down")
+    parser.add_argument("--hours", type=float, default=1)
+    parser.add_argument("--interval", type=float, default=10, help="seconds between two patterns")
+    parser.add_argument("--report", type=float, default=600, help="seconds between two reports")
+    parser.add_argument("--max-leak", type=float, default=500, help="bytes of free heap lost per hour")
+    args = parser.parse_args()
+
+    broker = Broker(args.broker_cmd)
+    time.sleep(1)
+    bulb = Bulb(args.device, args.broker, args.port)
+    patterns = [PATTERNS[name] for name in (args.pattern or ["burst", "slider"])]
+    started = time.monotonic()
+    next_report = started + args.report
+    try:
+        round_ = 0
+        while time.monotonic() - started < args.hours * 3600:
+            patterns[round_ % len(patterns)](bulb, args, broker)
+            round_ += 1
+            time.sleep(args.interval)
+            if time.monotonic() >= next_report:
+                report(bulb, started)
+                next_report += args.report
+    except KeyboardInterrupt:
+        pass
+    time.sleep(LATENCY_TIMEOUT_S)
+    dropped, leak = report(bulb, started)
+    bulb.client.loop_stop()
+    broker.stop()
+    return 1 if dropped > 0 or -leak > args.max_leak else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
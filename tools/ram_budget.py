@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+"""Report the RAM of the firmware and fail, when it exceeds the budget.
+
+    arduino-cli compile --fqbn esp8266:esp8266:generic --output-dir build .
+    ram_budget.py build/sonoff_b1.ino.elf
+    ram_budget.py build/sonoff_b1.ino.elf --url http://<bulb>/metrics
+
+Static RAM are the sections .data, .rodata and .bss of the ELF file (measured with
+xtensa-lx106-elf-size). With "--url" the heap metrics of a running bulb are checked too:
+the free heap at idle, the lowest free heap and the low-water mark after every timer.
+The exit code is 1, if a value is out of the budget.
+"""
+import argparse
+import re
+import subprocess
+import sys
+import urllib.request
+
+RAM_SECTIONS = (".data", ".rodata", ".bss")
+
+BUDGET = {
+    "static_ram_max": 40000,
+    "heap_idle_min": 16000,
+    "heap_low_min": 8000,
+}
+
+SAMPLE = re.compile(r'^myiot_(\w+)(?:\{timer="([^"]*)"\})? (\S+)$')
+
+
+def sections(elf, size_tool):
+    output = subprocess.check_output([size_tool, "-A", elf], universal_newlines=True)
+    ret = {}
+    for line in output.splitlines():
+        fields = line.split()
+        if len(fields) >= 2 and fields[0].startswith(".") and fields[1].isdigit():
+            ret[fields[0]] = int(fields[1])
+    return ret
+
+
+def metrics(url):
+    with urllib.request.urlopen(url, timeout=10) as response:
+        text = response.read().decode()
+    values = {}
+    timers = {}
+    for line in text.splitlines():
+        match = SAMPLE.match(line)
+        if not match:
+            continue
+        name, timer, value = match.groups()
+        if timer is None:
+            values[name] = float(value)
+        elif name == "timer_heap_low_bytes":
+            timers[timer] = float(value)
+    return values, timers
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("elf")
+    parser.add_argument("--url", help="metrics of a running bulb, e.g. http://<bulb>/metrics")
+    parser.add_argument("--size-tool", default="xtensa-lx106-elf-size")
+    for key, value in BUDGET.items():
+        parser.add_argument("--" + key.replace("_", "-"), type=int, default=value)
+    args = parser.parse_args()
+
+    failed = []
+
+    def check(label, value, limit, is_max):
+        ok = value <= limit if is_max else value >= limit
+        print("%-28s %8d  (%s %d)%s" % (label, value, "max" if is_max else "min", limit, "" if ok else "  OVER BUDGET"))
+        if not ok:
+            failed.append(label)
+
+    sizes = sections(args.elf, args.size_tool)
+    for name in RAM_SECTIONS:
+        print("%-28s %8d" % (name, sizes.get(name, 0)))
+    check("static RAM", sum(sizes.get(name, 0) for name in RAM_SECTIONS), args.static_ram_max, True)
+
+    if args.url:
+        values, timers = metrics(args.url)
+        check("heap at idle", values.get("heap_idle_bytes", 0), args.heap_idle_min, False)
+        check("heap low-water", values.get("heap_low_bytes", 0), args.heap_low_min, False)
+        for timer, value in sorted(timers.items(), key=lambda item: item[1]):
+            check("heap low-water " + timer, value, args.heap_low_min, False)
+
+    if failed:
+        print("over budget: " + ", ".join(failed), file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+"""Convert a binary trace dump of the bulb into Chrome trace JSON (chrome://tracing, Perfetto).
+
+    curl -s http://<bulb>/trace > trace.bin
+    mosquitto_sub -C 1 -t <device>/trace/dump > trace.bin   (after publishing to <device>/trace)
+    trace2chrome.py trace.bin > trace.json
+
+The format is described in src/myiot_trace.h.
+"""
+import json
+import struct
+import sys
+
+EVENTS = {
+    1: ("timer", "B"),
+    2: ("timer", "E"),
+    3: ("mqtt_callback", "B"),
+    4: ("mqtt_callback", "E"),
+    5: ("led_update", "B"),
+    6: ("led_update", "E"),
+    7: ("sunrise", "i"),
+}
+TIMER_EVENTS = (1, 2)
+
+
+def decode(data):
+    magic, version, entry_size, mhz, count = struct.unpack_from("<4sHHII", data, 0)
+    if magic != b"MTRC" or version != 1:
+        raise ValueError("not a trace dump")
+    offset = 16
+    entries = []
+    for _ in range(count):
+        entries.append(struct.unpack_from("<IHH", data, offset))
+        offset += entry_size
+
+    labels = {}
+    (label_count,) = struct.unpack_from("<H", data, offset)
+    offset += 2
+    for _ in range(label_count):
+        label_id, length = struct.unpack_from("<HB", data, offset)
+        offset += 3
+        labels[label_id] = data[offset:offset + length].decode()
+        offset += length
+    return mhz, entries, labels
+
+
+def to_chrome(mhz, entries, labels):
+    events = []
+    time = 0
+    last = None
+    for cycles, event, arg in entries:
+        if last is not None:
+            time += (cycles - last) & 0xFFFFFFFF  # the cycle counter wraps after 2^32
+        last = cycles
+        name, phase = EVENTS.get(event, ("event_%d" % event, "i"))
+        if event in TIMER_EVENTS:
+            name = labels.get(arg) or "timer_%d" % arg
+        record = {"name": name, "ph": phase, "ts": time / mhz, "pid": 1, "tid": 1, "args": {"arg": arg}}
+        if phase == "i":
+            record["s"] = "t"
+        events.append(record)
+    return {"traceEvents": events, "displayTimeUnit": "ms"}
+
+
+def main():
+    with open(sys.argv[1], "rb") if len(sys.argv) > 1 else sys.stdin.buffer as source:
+        mhz, entries, labels = decode(source.read())
+    json.dump(to_chrome(mhz, entries, labels), sys.stdout)
+
+
+if __name__ == "__main__":
+    main()